@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "sail.h"
+#include "rts.h"
+#include "riscv_config.h"
+#include "riscv_elf.h"
+#include "riscv_platform.h"
+#include "riscv_platform_impl.h"
+#include "riscv_sail.h"
+#include "libsailriscv.h"
+
+/* Snapshot slots in the model; must match max_snapshots in
+   tools/gen_hart_state.py. */
+#define SAILRISCV_MAX_SNAPSHOTS 8
+
+struct sailriscv {
+  uint64_t step_no;
+  uint64_t tick_count; // steps since the last clock tick
+  bool has_tohost;
+  bool halted;
+  uint64_t exit_code;
+};
+
+struct sailriscv_snapshot {
+  unsigned slot; // where the model keeps the registers
+  uint64_t step_no;
+  uint64_t tick_count;
+  bool reservation_valid;
+  uint64_t reservation;
+  uint64_t entropy_position;
+  std::vector<sailriscv_range_t> ranges;
+  std::vector<std::vector<uint8_t>> bytes;
+  std::vector<std::vector<uint8_t>> tags;
+};
+
+static sailriscv_t *instance = NULL;
+static bool snapshot_slot_used[SAILRISCV_MAX_SNAPSHOTS];
+
+static unsigned tag_granule_log2(void)
+{
+  return zxlen_val == 32 ? 3 : 4;
+}
+
+unsigned sailriscv_api_version(void)
+{
+  return SAILRISCV_API_VERSION;
+}
+
+sailriscv_t *sailriscv_create(void)
+{
+  if (instance != NULL)
+    return NULL;
+  instance = new sailriscv_t();
+
+  /* The host decides what to trace; default to quiet. */
+  config_print_instr = false;
+  config_print_reg = false;
+  config_print_mem_access = false;
+  config_print_platform = false;
+  config_print_step = false;
+  if (trace_log == NULL)
+    trace_log = stderr;
+
+  model_init();
+  zinit_model(UNIT);
+  rv_set_entropy_position(0);
+  return instance;
+}
+
+void sailriscv_destroy(sailriscv_t *h)
+{
+  if (h == NULL || h != instance)
+    return;
+  model_fini();
+  rv_tags_reset();
+  delete h;
+  instance = NULL;
+}
+
+unsigned sailriscv_xlen(sailriscv_t *)
+{
+  return (unsigned)zxlen_val;
+}
+
+sailriscv_status_t sailriscv_load_elf(sailriscv_t *h, const char *path,
+                                      uint64_t *entry)
+{
+  /* Memory may hold data from an earlier program, so write .bss too. */
+  const char *error;
+  rv_elf_t *elf = rv_elf_load(path, zxlen_val, /*zero_bss=*/true, &error);
+  if (elf == NULL)
+    return SAILRISCV_ERROR;
+  uint64_t e = rv_elf_entry(elf);
+  uint64_t tohost;
+  if (rv_elf_lookup(elf, "tohost", &tohost)) {
+    rv_htif_tohost = tohost;
+    h->has_tohost = true;
+  }
+  rv_elf_free(elf);
+  if (entry != NULL)
+    *entry = e;
+  return SAILRISCV_OK;
+}
+
+sailriscv_status_t sailriscv_reset(sailriscv_t *h, uint64_t entry,
+                                   const unsigned char *dtb, size_t dtb_len)
+{
+  zinit_model(UNIT);
+  rv_set_entropy_position(0);
+  rv_write_reset_vector(entry, dtb, dtb_len);
+  if (h->has_tohost) {
+    for (int i = 0; i < 8; i++)
+      write_mem(rv_htif_tohost + i, 0);
+  }
+  h->halted = false;
+  h->step_no = 0;
+  h->tick_count = 0;
+  return SAILRISCV_OK;
+}
+
+/* Watches tohost for the program's exit command. */
+static void check_tohost(sailriscv_t *h)
+{
+  if (h->has_tohost && rv_htif_poll(&h->exit_code))
+    h->halted = true;
+}
+
+/* Runs one step of the model; sets *stepped if an instruction retired.
+   Completion through tohost is noticed at the next clock tick. */
+static sailriscv_status_t step_one(sailriscv_t *h, bool *stepped)
+{
+  sail_int sail_step;
+  CREATE(sail_int)(&sail_step);
+  CONVERT_OF(sail_int, mach_int)(&sail_step, h->step_no);
+  *stepped = zstep(sail_step);
+  KILL(sail_int)(&sail_step);
+  if (have_exception)
+    return SAILRISCV_ERROR;
+  if (*stepped) {
+    h->step_no++;
+    h->tick_count++;
+  }
+
+  if (h->tick_count == rv_insns_per_tick) {
+    h->tick_count = 0;
+    ztick_clock(rv_insns_per_tick);
+    ztick_platform(UNIT);
+    check_tohost(h);
+  }
+  return h->halted ? SAILRISCV_HALTED : SAILRISCV_OK;
+}
+
+sailriscv_status_t sailriscv_step(sailriscv_t *h, uint64_t n,
+                                  uint64_t *retired)
+{
+  sailriscv_status_t status = SAILRISCV_OK;
+  uint64_t count = 0;
+  for (uint64_t i = 0; i < n && status == SAILRISCV_OK; i++) {
+    bool stepped;
+    status = step_one(h, &stepped);
+    count += stepped;
+  }
+  if (retired != NULL)
+    *retired = count;
+  return status;
+}
+
+sailriscv_status_t sailriscv_run_until(sailriscv_t *h, uint64_t pc,
+                                       uint64_t max_steps, uint64_t *retired)
+{
+  sailriscv_status_t status = SAILRISCV_OK;
+  uint64_t count = 0;
+  for (uint64_t i = 0; max_steps == 0 || i < max_steps; i++) {
+    if (zembed_read_pc(UNIT) == pc) {
+      status = SAILRISCV_BREAKPOINT;
+      break;
+    }
+    bool stepped;
+    status = step_one(h, &stepped);
+    count += stepped;
+    if (status != SAILRISCV_OK)
+      break;
+  }
+  if (retired != NULL)
+    *retired = count;
+  return status;
+}
+
+uint64_t sailriscv_exit_code(sailriscv_t *h)
+{
+  return h->exit_code;
+}
+
+uint64_t sailriscv_get_pc(sailriscv_t *)
+{
+  return zembed_read_pc(UNIT);
+}
+
+void sailriscv_set_pc(sailriscv_t *, uint64_t pc)
+{
+  zembed_write_pc(pc);
+}
+
+sailriscv_status_t sailriscv_get_gpr(sailriscv_t *, unsigned r, uint64_t *val)
+{
+  if (r >= 32)
+    return SAILRISCV_ERROR;
+  *val = zembed_read_gpr(r);
+  return SAILRISCV_OK;
+}
+
+sailriscv_status_t sailriscv_set_gpr(sailriscv_t *, unsigned r, uint64_t val)
+{
+  if (r >= 32)
+    return SAILRISCV_ERROR;
+  zembed_write_gpr(r, val);
+  return SAILRISCV_OK;
+}
+
+sailriscv_status_t sailriscv_get_cap(sailriscv_t *, unsigned r,
+                                     sailriscv_cap_t *cap)
+{
+  if (r > SAILRISCV_CAP_DDC)
+    return SAILRISCV_ERROR;
+  cap->tag = zembed_read_cap_tag(r);
+  cap->metadata = zembed_read_cap_metadata(r);
+  cap->address = zembed_read_cap_address(r);
+  return SAILRISCV_OK;
+}
+
+sailriscv_status_t sailriscv_set_cap(sailriscv_t *, unsigned r,
+                                     const sailriscv_cap_t *cap)
+{
+  if (r > SAILRISCV_CAP_DDC)
+    return SAILRISCV_ERROR;
+  zembed_write_cap(r, cap->tag, cap->metadata, cap->address);
+  return SAILRISCV_OK;
+}
+
+sailriscv_status_t sailriscv_get_csr(sailriscv_t *, unsigned csr, uint64_t *val)
+{
+  if (csr >= 4096 || !zembed_csr_defined(csr))
+    return SAILRISCV_ERROR;
+  *val = zembed_read_csr(csr);
+  return SAILRISCV_OK;
+}
+
+sailriscv_status_t sailriscv_set_csr(sailriscv_t *, unsigned csr, uint64_t val)
+{
+  /* csr[11:10] == 0b11 marks the read-only CSRs. */
+  if (csr >= 4096 || (csr >> 10) == 3 || !zembed_csr_defined(csr))
+    return SAILRISCV_ERROR;
+  zembed_write_csr(csr, val);
+  return SAILRISCV_OK;
+}
+
+void sailriscv_read_mem(sailriscv_t *, uint64_t addr, void *buf, size_t len)
+{
+  uint8_t *p = (uint8_t *)buf;
+  for (size_t i = 0; i < len; i++)
+    p[i] = (uint8_t)read_mem(addr + i);
+}
+
+void sailriscv_write_mem(sailriscv_t *, uint64_t addr, const void *buf,
+                         size_t len)
+{
+  const uint8_t *p = (const uint8_t *)buf;
+  for (size_t i = 0; i < len; i++)
+    write_mem(addr + i, p[i]);
+  rv_clear_tag_range(addr, len);
+}
+
+size_t sailriscv_cap_size(sailriscv_t *)
+{
+  return (size_t)1 << tag_granule_log2();
+}
+
+bool sailriscv_read_tag(sailriscv_t *, uint64_t addr)
+{
+  return plat_read_tag(addr >> tag_granule_log2());
+}
+
+void sailriscv_write_tag(sailriscv_t *, uint64_t addr, bool tag)
+{
+  plat_write_tag(addr >> tag_granule_log2(), tag);
+}
+
+void sailriscv_read_tags(sailriscv_t *, uint64_t addr, uint8_t *tags,
+                         size_t count)
+{
+  uint64_t first = addr >> tag_granule_log2();
+  for (size_t i = 0; i < count; i++)
+    tags[i] = plat_read_tag(first + i);
+}
+
+void sailriscv_clear_tags(sailriscv_t *, uint64_t addr, uint64_t len)
+{
+  rv_clear_tag_range(addr, len);
+}
+
+sailriscv_snapshot_t *sailriscv_snapshot(sailriscv_t *h,
+                                         const sailriscv_range_t *ranges,
+                                         size_t nranges)
+{
+  unsigned slot = 0;
+  while (slot < SAILRISCV_MAX_SNAPSHOTS && snapshot_slot_used[slot])
+    slot++;
+  if (slot == SAILRISCV_MAX_SNAPSHOTS)
+    return NULL;
+  snapshot_slot_used[slot] = true;
+
+  sailriscv_snapshot_t *s = new sailriscv_snapshot_t();
+  s->slot = slot;
+  zsnapshot_save(slot);
+  s->step_no = h->step_no;
+  s->tick_count = h->tick_count;
+  s->reservation_valid = rv_get_reservation(&s->reservation);
+  s->entropy_position = rv_get_entropy_position();
+
+  unsigned shift = tag_granule_log2();
+  for (size_t i = 0; i < nranges; i++) {
+    const sailriscv_range_t &r = ranges[i];
+    s->ranges.push_back(r);
+    s->bytes.emplace_back(r.len);
+    sailriscv_read_mem(h, r.base, s->bytes.back().data(), r.len);
+    uint64_t ntags = r.len == 0
+        ? 0
+        : ((r.base + r.len - 1) >> shift) - (r.base >> shift) + 1;
+    s->tags.emplace_back(ntags);
+    sailriscv_read_tags(h, r.base, s->tags.back().data(), ntags);
+  }
+  return s;
+}
+
+sailriscv_status_t sailriscv_restore(sailriscv_t *h,
+                                     const sailriscv_snapshot_t *s)
+{
+  if (s == NULL)
+    return SAILRISCV_ERROR;
+
+  zsnapshot_restore(s->slot);
+  h->step_no = s->step_no;
+  h->tick_count = s->tick_count;
+  rv_set_reservation(s->reservation_valid, s->reservation);
+  rv_set_entropy_position(s->entropy_position);
+
+  /* Memory first, then tags, as writing memory clears them. */
+  unsigned shift = tag_granule_log2();
+  for (size_t i = 0; i < s->ranges.size(); i++) {
+    const sailriscv_range_t &r = s->ranges[i];
+    sailriscv_write_mem(h, r.base, s->bytes[i].data(), r.len);
+    uint64_t first = r.base >> shift;
+    for (size_t t = 0; t < s->tags[i].size(); t++)
+      plat_write_tag(first + t, s->tags[i][t] != 0);
+  }
+  h->halted = false;
+  return SAILRISCV_OK;
+}
+
+void sailriscv_snapshot_free(sailriscv_snapshot_t *s)
+{
+  if (s == NULL)
+    return;
+  snapshot_slot_used[s->slot] = false;
+  delete s;
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* C interface for embedding the model in another program.
+
+   The model keeps its state in globals, so there can only be one live
+   instance per process: sailriscv_create() returns NULL while another
+   instance exists. None of the functions are thread-safe.
+
+   Functions returning sailriscv_status_t return SAILRISCV_ERROR on invalid
+   arguments (an unknown register, an undefined CSR, a missing file) and
+   leave the model untouched in that case.
+
+   Only the types below cross the interface, so hosts need nothing but this
+   header and the shared library. SAILRISCV_API_VERSION is bumped on any
+   incompatible change; compare it with sailriscv_api_version() at runtime.
+ */
+
+#define SAILRISCV_API_VERSION 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sailriscv sailriscv_t;
+typedef struct sailriscv_snapshot sailriscv_snapshot_t;
+
+typedef enum {
+  SAILRISCV_OK = 0,
+  /* run_until() reached the requested PC. */
+  SAILRISCV_BREAKPOINT,
+  /* The program signalled completion through HTIF tohost; see
+     sailriscv_exit_code(). This is checked at each clock tick, so a few
+     more instructions may have executed. */
+  SAILRISCV_HALTED,
+  SAILRISCV_ERROR,
+} sailriscv_status_t;
+
+/* Capability register numbers beyond the 32 general purpose registers. */
+#define SAILRISCV_CAP_PCC 32
+#define SAILRISCV_CAP_DDC 33
+
+/* A capability in its in-memory format: `metadata` holds the upper XLEN
+   bits and `address` the lower XLEN bits. */
+typedef struct {
+  uint64_t metadata;
+  uint64_t address;
+  bool tag;
+} sailriscv_cap_t;
+
+unsigned sailriscv_api_version(void);
+
+sailriscv_t *sailriscv_create(void);
+void sailriscv_destroy(sailriscv_t *h);
+
+/* 32 or 64. */
+unsigned sailriscv_xlen(sailriscv_t *h);
+
+/* Loads an ELF file into memory and returns its entry point. The `tohost`
+   symbol, if present, becomes the HTIF port. */
+sailriscv_status_t sailriscv_load_elf(sailriscv_t *h, const char *path,
+                                      uint64_t *entry);
+
+/* Resets the hart and the entropy stream, and writes the boot ROM, which
+   jumps to `entry`. The device tree blob is optional (NULL, 0). Memory
+   other than the ROM and tohost is left as it is. */
+sailriscv_status_t sailriscv_reset(sailriscv_t *h, uint64_t entry,
+                                   const unsigned char *dtb, size_t dtb_len);
+
+/* Executes up to `n` steps and stores the number of retired instructions in
+   `*retired` (which may be NULL). */
+sailriscv_status_t sailriscv_step(sailriscv_t *h, uint64_t n,
+                                  uint64_t *retired);
+
+/* Executes until the PC equals `pc`, for at most `max_steps` steps (0 for no
+   limit). The instruction at `pc` is not executed. */
+sailriscv_status_t sailriscv_run_until(sailriscv_t *h, uint64_t pc,
+                                       uint64_t max_steps, uint64_t *retired);
+
+/* The HTIF exit code once a step returned SAILRISCV_HALTED. */
+uint64_t sailriscv_exit_code(sailriscv_t *h);
+
+/* Registers. Writing an integer register clears its capability tag. */
+uint64_t sailriscv_get_pc(sailriscv_t *h);
+void sailriscv_set_pc(sailriscv_t *h, uint64_t pc);
+sailriscv_status_t sailriscv_get_gpr(sailriscv_t *h, unsigned r,
+                                     uint64_t *val);
+sailriscv_status_t sailriscv_set_gpr(sailriscv_t *h, unsigned r, uint64_t val);
+sailriscv_status_t sailriscv_get_cap(sailriscv_t *h, unsigned r,
+                                     sailriscv_cap_t *cap);
+sailriscv_status_t sailriscv_set_cap(sailriscv_t *h, unsigned r,
+                                     const sailriscv_cap_t *cap);
+
+/* CSRs, with the legalisation applied by the model on writes. Writes take
+   effect at once (a write to minstret reads back as written). Fails for
+   CSRs that are not defined in the current configuration, and on writes to
+   read-only CSRs. */
+sailriscv_status_t sailriscv_get_csr(sailriscv_t *h, unsigned csr,
+                                     uint64_t *val);
+sailriscv_status_t sailriscv_set_csr(sailriscv_t *h, unsigned csr,
+                                     uint64_t val);
+
+/* Physical memory. Writes clear the tags of the granules they touch. */
+void sailriscv_read_mem(sailriscv_t *h, uint64_t addr, void *buf, size_t len);
+void sailriscv_write_mem(sailriscv_t *h, uint64_t addr, const void *buf,
+                         size_t len);
+
+/* Capability tags, one per aligned granule of sailriscv_cap_size() bytes. */
+size_t sailriscv_cap_size(sailriscv_t *h);
+bool sailriscv_read_tag(sailriscv_t *h, uint64_t addr);
+void sailriscv_write_tag(sailriscv_t *h, uint64_t addr, bool tag);
+/* Reads the tags of the granules starting at `addr` into `tags`, one per
+   byte. */
+void sailriscv_read_tags(sailriscv_t *h, uint64_t addr, uint8_t *tags,
+                         size_t count);
+void sailriscv_clear_tags(sailriscv_t *h, uint64_t addr, uint64_t len);
+
+/* Snapshots of the model state: every register of the model (the PC,
+   integer, capability, floating-point and vector registers, the CSRs and
+   the counters behind them, the privilege level, the TLB, mtime and the
+   CLINT, the revoker), the LR/SC reservation, the position in the entropy
+   stream of the seed CSR, and the given physical memory ranges with their
+   tags. Registers are saved and restored as they are, without going through
+   CSR writes.
+
+   Not saved: memory outside the listed ranges (the model cannot enumerate
+   it), and entropy already read from /dev/urandom. At most 8 snapshots
+   exist at a time; sailriscv_snapshot() returns NULL when all are in use. */
+typedef struct {
+  uint64_t base;
+  uint64_t len;
+} sailriscv_range_t;
+
+sailriscv_snapshot_t *sailriscv_snapshot(sailriscv_t *h,
+                                         const sailriscv_range_t *ranges,
+                                         size_t nranges);
+sailriscv_status_t sailriscv_restore(sailriscv_t *h,
+                                     const sailriscv_snapshot_t *s);
+void sailriscv_snapshot_free(sailriscv_snapshot_t *s);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,145 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sail.h"
+#include "riscv_sail.h"
+#include "riscv_bbv.h"
+
+static FILE *bbv_out = NULL;
+static uint64_t bbv_interval;
+static const char *bbv_checkpoint_dir = NULL;
+
+/* Block ids by start address, and the instructions counted for each id
+   (indexed by id) in the current interval. */
+static std::unordered_map<uint64_t, uint32_t> block_ids;
+static std::vector<uint64_t> block_counts(1);
+static std::vector<uint32_t> touched;
+
+/* The block being executed, of which block_len instructions are not yet
+   counted. A block that spans an interval boundary stays open, so both
+   parts are counted under its start address. */
+static bool block_open = false;
+static uint64_t block_start, block_len, expected_pc;
+static uint64_t interval_len, interval_no;
+
+bool rv_bbv_open(const char *path, uint64_t interval,
+                 const char *checkpoint_dir)
+{
+  bbv_out = fopen(path, "w");
+  if (bbv_out == NULL) {
+    fprintf(stderr, "Cannot open BBV file '%s': %s\n", path, strerror(errno));
+    return false;
+  }
+  bbv_interval = interval;
+  bbv_checkpoint_dir = checkpoint_dir;
+  block_ids.clear();
+  block_counts.assign(1, 0);
+  touched.clear();
+  block_open = false;
+  block_len = 0;
+  interval_len = interval_no = 0;
+  return true;
+}
+
+static void count_block(void)
+{
+  if (block_len == 0)
+    return;
+  auto it = block_ids.emplace(block_start, (uint32_t)block_counts.size());
+  uint32_t id = it.first->second;
+  if (it.second)
+    block_counts.push_back(0);
+  if (block_counts[id] == 0)
+    touched.push_back(id);
+  block_counts[id] += block_len;
+  block_len = 0;
+}
+
+static void end_block(void)
+{
+  count_block();
+  block_open = false;
+}
+
+static void write_checkpoint(void)
+{
+  std::string path = std::string(bbv_checkpoint_dir) + "/interval-"
+      + std::to_string(interval_no) + ".ckpt";
+  FILE *f = fopen(path.c_str(), "w");
+  if (f == NULL) {
+    fprintf(stderr, "Cannot write checkpoint '%s': %s\n", path.c_str(),
+            strerror(errno));
+    return;
+  }
+  fprintf(f, "instructions %" PRIu64 "\n", interval_no * bbv_interval);
+  fprintf(f, "pc 0x%" PRIx64 "\n", zembed_read_pc(UNIT));
+  fprintf(f, "privilege %" PRIu64 "\n", zembed_read_privilege(UNIT));
+  /* 0-31 are the GPRs, 32 PCC and 33 DDC, as in libsailriscv. */
+  for (unsigned r = 0; r <= 33; r++)
+    fprintf(f, "cap %u %d 0x%" PRIx64 " 0x%" PRIx64 "\n", r,
+            zembed_read_cap_tag(r), zembed_read_cap_metadata(r),
+            zembed_read_cap_address(r));
+  for (unsigned csr = 0; csr < 4096; csr++) {
+    /* Reading seed has side effects. */
+    if (csr != 0x015 && zembed_csr_defined(csr))
+      fprintf(f, "csr 0x%03x 0x%" PRIx64 "\n", csr, zembed_read_csr(csr));
+  }
+  fclose(f);
+}
+
+static void end_interval(void)
+{
+  count_block();
+  std::sort(touched.begin(), touched.end());
+  fputc('T', bbv_out);
+  for (uint32_t id : touched) {
+    fprintf(bbv_out, ":%u:%" PRIu64 " ", id, block_counts[id]);
+    block_counts[id] = 0;
+  }
+  fputc('\n', bbv_out);
+  touched.clear();
+  interval_len = 0;
+  interval_no++;
+}
+
+void rv_bbv_retire(uint64_t pc, uint64_t next_pc, uint32_t insn)
+{
+  /* A trap or interrupt between instructions also ends the block. */
+  if (block_open && pc != expected_pc)
+    end_block();
+  if (!block_open) {
+    block_open = true;
+    block_start = pc;
+  }
+  block_len++;
+  /* A compressed jump over the next instruction moves the PC by 4, which
+     must still end the block. */
+  uint64_t fall_through = pc + ((insn & 3) == 3 ? 4 : 2);
+  if (next_pc == fall_through)
+    expected_pc = next_pc;
+  else
+    end_block();
+
+  if (++interval_len == bbv_interval) {
+    end_interval();
+    if (bbv_checkpoint_dir != NULL)
+      write_checkpoint();
+  }
+}
+
+void rv_bbv_close(void)
+{
+  if (bbv_out == NULL)
+    return;
+  if (interval_len != 0)
+    end_interval();
+  fclose(bbv_out);
+  bbv_out = NULL;
+}
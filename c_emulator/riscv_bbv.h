@@ -0,0 +1,42 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Basic-block vector profiling for SimPoint.
+
+   Every `interval` retired instructions, one line of the form
+
+     T:<block id>:<instructions> :<block id>:<instructions> ...
+
+   is appended to the output, counting the instructions executed in each
+   basic block during the interval. Blocks are numbered from 1 in order of
+   first execution. A block ends at any instruction after which the PC does
+   not simply advance past it (a taken branch, jump or trap); as in other
+   PC-based profilers, a not-taken branch does not end one.
+
+   Interval k starts after k * interval instructions, so a chosen interval
+   can be reached with --ff-until-insns. If a checkpoint directory is set,
+   the architectural registers at each boundary are also written to
+   <dir>/interval-<k>.ckpt, to check that a replay arrived at the same
+   state.
+
+   Opening the output starts a new profile, numbering blocks from 1 again.
+ */
+
+bool rv_bbv_open(const char *path, uint64_t interval,
+                 const char *checkpoint_dir);
+
+/* Records one retired instruction `insn` at `pc`, with `next_pc` the PC
+   after it retired. */
+void rv_bbv_retire(uint64_t pc, uint64_t next_pc, uint32_t insn);
+
+/* Writes the final, partial interval and closes the output. */
+void rv_bbv_close(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
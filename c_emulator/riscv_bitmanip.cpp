@@ -0,0 +1,94 @@
+#include "riscv_bitmanip.h"
+
+/* _mm_cvtsi64_si128 and _mm_cvtsi128_si64 only exist on x86-64. */
+#ifdef __x86_64__
+#include <immintrin.h>
+#define HAVE_PCLMUL_TARGET 1
+#endif
+
+static inline uint64_t width_mask(mach_int width)
+{
+  return width == 64 ? UINT64_MAX : (UINT64_C(1) << width) - 1;
+}
+
+mach_bits rv_native_clz(mach_int width, mach_bits a)
+{
+  a &= width_mask(width);
+  if (a == 0)
+    return width;
+  return __builtin_clzll(a) - (64 - width);
+}
+
+mach_bits rv_native_ctz(mach_int width, mach_bits a)
+{
+  a &= width_mask(width);
+  if (a == 0)
+    return width;
+  return __builtin_ctzll(a);
+}
+
+mach_bits rv_native_cpop(mach_int width, mach_bits a)
+{
+  return __builtin_popcountll(a & width_mask(width));
+}
+
+/* The 128-bit carry-less product of a and b, as its low and high halves. */
+typedef void (*clmul_fn)(uint64_t a, uint64_t b, uint64_t *lo, uint64_t *hi);
+
+static void clmul_portable(uint64_t a, uint64_t b, uint64_t *lo, uint64_t *hi)
+{
+  uint64_t l = 0, h = 0;
+  while (b != 0) {
+    int i = __builtin_ctzll(b);
+    l ^= a << i;
+    if (i != 0)
+      h ^= a >> (64 - i);
+    b &= b - 1;
+  }
+  *lo = l;
+  *hi = h;
+}
+
+#ifdef HAVE_PCLMUL_TARGET
+__attribute__((target("pclmul,sse2"))) static void
+clmul_pclmul(uint64_t a, uint64_t b, uint64_t *lo, uint64_t *hi)
+{
+  __m128i p = _mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)a),
+                                   _mm_cvtsi64_si128((long long)b), 0);
+  *lo = (uint64_t)_mm_cvtsi128_si64(p);
+  *hi = (uint64_t)_mm_cvtsi128_si64(_mm_unpackhi_epi64(p, p));
+}
+#endif
+
+static clmul_fn select_clmul(void)
+{
+#ifdef HAVE_PCLMUL_TARGET
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("pclmul"))
+    return clmul_pclmul;
+#endif
+  return clmul_portable;
+}
+
+static clmul_fn clmul = select_clmul();
+
+void rv_bitmanip_use_portable(void)
+{
+  clmul = clmul_portable;
+}
+
+mach_bits rv_native_clmul(mach_int width, mach_bits op, mach_bits a,
+                          mach_bits b)
+{
+  uint64_t mask = width_mask(width);
+  uint64_t lo, hi;
+  clmul(a & mask, b & mask, &lo, &hi);
+  switch (op) {
+  case 1: /* clmul: bits [width-1:0] */
+    return lo & mask;
+  case 2: /* clmulr: bits [2*width-2:width-1] */
+    return width == 64 ? (lo >> 63) | (hi << 1) : (lo >> 31) & mask;
+  default: /* clmulh: bits [2*width-1:width] */
+    return width == 64 ? hi : (lo >> 32) & mask;
+  }
+}
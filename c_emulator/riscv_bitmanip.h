@@ -0,0 +1,32 @@
+#pragma once
+#include "sail.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Native implementations of the Zbb bit counting and Zbc carry-less
+   multiply instructions.
+
+   Operands and results occupy the low `width` bits (32 or 64) of a 64-bit
+   value. Carry-less multiplication uses PCLMULQDQ when the host CPU
+   supports it, detected at startup, and a portable shift-and-xor loop
+   otherwise. The reference definitions are in riscv_insts_zbb.sail and
+   riscv_insts_zbc.sail.
+ */
+
+mach_bits rv_native_clz(mach_int width, mach_bits a);
+mach_bits rv_native_ctz(mach_int width, mach_bits a);
+mach_bits rv_native_cpop(mach_int width, mach_bits a);
+
+/* `op` is the funct3 encoding: 1 CLMUL, 2 CLMULR, 3 CLMULH. */
+mach_bits rv_native_clmul(mach_int width, mach_bits op, mach_bits a,
+                          mach_bits b);
+
+/* Uses the portable carry-less multiply even on hosts with PCLMULQDQ, so
+   that both can be checked against the model. */
+void rv_bitmanip_use_portable(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,439 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "riscv_cache.h"
+
+bool rv_cache_enabled = false;
+
+#define NO_LINE (~UINT64_C(0))
+
+/* Replacement state is a use stamp per line for LRU, or a tree of
+   ways - 1 bits per set for pseudo-LRU. */
+struct cache {
+  std::string name;
+  unsigned ways, set_bits, latency;
+  std::vector<uint64_t> tags; /* line address, or NO_LINE */
+  std::vector<uint8_t> dirty;
+  std::vector<uint64_t> repl;
+  uint64_t stamp;
+  uint64_t reads, read_misses, writes, write_misses, writebacks;
+};
+
+struct cache_config {
+  bool present;
+  uint64_t size;
+  unsigned ways, latency;
+};
+
+/* Configuration: L1I, L1D and L2. */
+static const cache_config default_config[3] = {
+    {false, 0, 0, 1 },
+    {false, 0, 0, 4 },
+    {false, 0, 0, 12},
+};
+static cache_config config[3];
+static const char *config_names[3] = {"l1i", "l1d", "l2"};
+static unsigned mem_latency = 100;
+static bool use_plru = false;
+
+static unsigned line_exp;
+static std::vector<cache> l1i, l1d; /* one per hart */
+static std::vector<cache> l2;       /* zero or one */
+static uint64_t accesses[3], cycles, mem_writebacks, block_ops[4];
+
+static bool parse_size(const char *s, uint64_t *size)
+{
+  char *end;
+  errno = 0;
+  uint64_t v = strtoull(s, &end, 0);
+  if (errno != 0 || end == s)
+    return false;
+  if (*end == 'K' || *end == 'k') {
+    v <<= 10;
+    end++;
+  } else if (*end == 'M' || *end == 'm') {
+    v <<= 20;
+    end++;
+  }
+  *size = v;
+  return *end == '\0';
+}
+
+static bool parse_unsigned(const char *s, unsigned *v)
+{
+  char *end;
+  errno = 0;
+  unsigned long n = strtoul(s, &end, 0);
+  if (errno != 0 || end == s || *end != '\0' || n > UINT32_MAX)
+    return false;
+  *v = (unsigned)n;
+  return true;
+}
+
+static bool parse_item(const std::string &item)
+{
+  size_t eq = item.find('=');
+  if (eq == std::string::npos)
+    return false;
+  std::string key = item.substr(0, eq), value = item.substr(eq + 1);
+  if (key == "mem")
+    return parse_unsigned(value.c_str(), &mem_latency);
+  if (key == "policy") {
+    if (value != "lru" && value != "plru")
+      return false;
+    use_plru = value == "plru";
+    return true;
+  }
+  for (unsigned i = 0; i < 3; i++) {
+    if (key != config_names[i])
+      continue;
+    std::vector<std::string> fields;
+    size_t start = 0, colon;
+    while ((colon = value.find(':', start)) != std::string::npos) {
+      fields.push_back(value.substr(start, colon - start));
+      start = colon + 1;
+    }
+    fields.push_back(value.substr(start));
+    if (fields.size() < 2 || fields.size() > 3)
+      return false;
+    cache_config &c = config[i];
+    if (!parse_size(fields[0].c_str(), &c.size)
+        || !parse_unsigned(fields[1].c_str(), &c.ways)
+        || (fields.size() == 3
+            && !parse_unsigned(fields[2].c_str(), &c.latency)))
+      return false;
+    c.present = true;
+    return true;
+  }
+  return false;
+}
+
+bool rv_cache_configure(const char *spec)
+{
+  std::copy(default_config, default_config + 3, config);
+  mem_latency = 100;
+  use_plru = false;
+  std::string s(spec);
+  size_t start = 0;
+  while (start <= s.size()) {
+    size_t comma = s.find(',', start);
+    if (comma == std::string::npos)
+      comma = s.size();
+    std::string item = s.substr(start, comma - start);
+    if (!parse_item(item)) {
+      fprintf(stderr, "invalid cache model item '%s'.\n", item.c_str());
+      return false;
+    }
+    start = comma + 1;
+  }
+  rv_cache_enabled = true;
+  return true;
+}
+
+static bool is_pow2(uint64_t x)
+{
+  return x != 0 && (x & (x - 1)) == 0;
+}
+
+static bool make_cache(const char *name, const cache_config &c, cache *out)
+{
+  uint64_t line = UINT64_C(1) << line_exp;
+  if (c.ways == 0 || c.size % (c.ways * line) != 0
+      || !is_pow2(c.size / (c.ways * line))) {
+    fprintf(stderr,
+            "%s: size %" PRIu64 " is not a power-of-two number of sets of "
+            "%u ways of %" PRIu64 " byte lines.\n",
+            name, c.size, c.ways, line);
+    return false;
+  }
+  if (use_plru && (!is_pow2(c.ways) || c.ways > 32)) {
+    fprintf(stderr, "%s: pseudo-LRU needs a power of two of at most 32 "
+                    "ways.\n",
+            name);
+    return false;
+  }
+  uint64_t sets = c.size / (c.ways * line);
+  out->name = name;
+  out->ways = c.ways;
+  out->set_bits = 0;
+  while ((UINT64_C(1) << out->set_bits) < sets)
+    out->set_bits++;
+  out->latency = c.latency;
+  out->tags.assign(sets * c.ways, NO_LINE);
+  out->dirty.assign(sets * c.ways, 0);
+  out->repl.assign(use_plru ? sets : sets * c.ways, 0);
+  out->stamp = 0;
+  out->reads = out->read_misses = out->writes = out->write_misses = 0;
+  out->writebacks = 0;
+  return true;
+}
+
+bool rv_cache_init(unsigned block_exp, uint64_t harts)
+{
+  line_exp = block_exp;
+  l1i.clear();
+  l1d.clear();
+  l2.clear();
+  std::fill(accesses, accesses + 3, 0);
+  std::fill(block_ops, block_ops + 4, 0);
+  cycles = mem_writebacks = 0;
+  for (uint64_t h = 0; h < harts; h++) {
+    std::string suffix = harts > 1 ? "[" + std::to_string(h) + "]" : "";
+    if (config[0].present) {
+      l1i.emplace_back();
+      if (!make_cache(("L1I" + suffix).c_str(), config[0], &l1i.back()))
+        return false;
+    }
+    if (config[1].present) {
+      l1d.emplace_back();
+      if (!make_cache(("L1D" + suffix).c_str(), config[1], &l1d.back()))
+        return false;
+    }
+  }
+  if (config[2].present) {
+    l2.emplace_back();
+    if (!make_cache("L2", config[2], &l2.back()))
+      return false;
+  }
+  return true;
+}
+
+/* Tree pseudo-LRU over a power-of-two number of ways: node n (from 1) has
+   children 2n and 2n + 1, and its bit is set if the victim is on the
+   right. */
+static void plru_touch(uint64_t &tree, unsigned ways, unsigned way)
+{
+  unsigned node = 1;
+  for (unsigned half = ways / 2; half >= 1; half /= 2) {
+    unsigned right = (way & half) != 0;
+    if (right)
+      tree &= ~(UINT64_C(1) << node);
+    else
+      tree |= UINT64_C(1) << node;
+    node = 2 * node + right;
+  }
+}
+
+static unsigned plru_victim(uint64_t tree, unsigned ways)
+{
+  unsigned node = 1, way = 0;
+  for (unsigned half = ways / 2; half >= 1; half /= 2) {
+    unsigned right = (tree >> node) & 1;
+    if (right)
+      way |= half;
+    node = 2 * node + right;
+  }
+  return way;
+}
+
+static void touch(cache &c, uint64_t set, unsigned way)
+{
+  if (use_plru)
+    plru_touch(c.repl[set], c.ways, way);
+  else
+    c.repl[set * c.ways + way] = ++c.stamp;
+}
+
+static unsigned victim(const cache &c, uint64_t set)
+{
+  uint64_t base = set * c.ways;
+  for (unsigned w = 0; w < c.ways; w++) {
+    if (c.tags[base + w] == NO_LINE)
+      return w;
+  }
+  if (use_plru)
+    return plru_victim(c.repl[set], c.ways);
+  unsigned oldest = 0;
+  for (unsigned w = 1; w < c.ways; w++) {
+    if (c.repl[base + w] < c.repl[base + oldest])
+      oldest = w;
+  }
+  return oldest;
+}
+
+/* Returns the slot of `line`, or -1 if it is not present. */
+static int64_t find(const cache &c, uint64_t line)
+{
+  uint64_t set = line & ((UINT64_C(1) << c.set_bits) - 1);
+  uint64_t base = set * c.ways;
+  for (unsigned w = 0; w < c.ways; w++) {
+    if (c.tags[base + w] == line)
+      return (int64_t)(base + w);
+  }
+  return -1;
+}
+
+/* Looks up `line`, allocating it on a miss. Returns whether it hit and sets
+   `*evicted` to a dirty line that was evicted, or NO_LINE. */
+static bool lookup(cache &c, uint64_t line, bool write, uint64_t *evicted)
+{
+  uint64_t set = line & ((UINT64_C(1) << c.set_bits) - 1);
+  uint64_t base = set * c.ways;
+  *evicted = NO_LINE;
+  if (write)
+    c.writes++;
+  else
+    c.reads++;
+  for (unsigned w = 0; w < c.ways; w++) {
+    if (c.tags[base + w] == line) {
+      touch(c, set, w);
+      c.dirty[base + w] |= write;
+      return true;
+    }
+  }
+  if (write)
+    c.write_misses++;
+  else
+    c.read_misses++;
+  unsigned w = victim(c, set);
+  if (c.tags[base + w] != NO_LINE && c.dirty[base + w]) {
+    *evicted = c.tags[base + w];
+    c.writebacks++;
+  }
+  c.tags[base + w] = line;
+  c.dirty[base + w] = write;
+  touch(c, set, w);
+  return false;
+}
+
+/* A dirty line leaving an L1 cache. */
+static void write_back(uint64_t line)
+{
+  if (l2.empty()) {
+    mem_writebacks++;
+    return;
+  }
+  uint64_t evicted;
+  lookup(l2[0], line, true, &evicted);
+  if (evicted != NO_LINE)
+    mem_writebacks++;
+}
+
+unsigned rv_cache_access(uint64_t hart, unsigned kind, uint64_t addr,
+                         uint64_t width)
+{
+  unsigned misses = 0;
+  bool write = kind == RV_CACHE_STORE;
+  std::vector<cache> &l1s = kind == RV_CACHE_FETCH ? l1i : l1d;
+  uint64_t first = addr >> line_exp;
+  uint64_t last = (addr + (width ? width - 1 : 0)) >> line_exp;
+
+  accesses[kind]++;
+  for (uint64_t line = first; line <= last; line++) {
+    uint64_t evicted;
+    bool fill_write = write;
+    if (!l1s.empty()) {
+      cache &l1 = l1s[hart];
+      cycles += l1.latency;
+      if (lookup(l1, line, write, &evicted))
+        continue;
+      misses |= RV_CACHE_L1_MISS;
+      if (evicted != NO_LINE)
+        write_back(evicted);
+      /* The line is fetched from below and written in the L1. */
+      fill_write = false;
+    }
+    if (!l2.empty()) {
+      cycles += l2[0].latency;
+      if (lookup(l2[0], line, fill_write, &evicted))
+        continue;
+      if (evicted != NO_LINE)
+        mem_writebacks++;
+    }
+    cycles += mem_latency;
+    misses |= RV_CACHE_MEM_MISS;
+  }
+  return misses;
+}
+
+/* Cleans or invalidates `line` in `c`; returns whether it was dirty. */
+static bool maintain(cache &c, uint64_t line, bool invalidate)
+{
+  int64_t slot = find(c, line);
+  if (slot < 0)
+    return false;
+  bool was_dirty = c.dirty[slot];
+  c.dirty[slot] = 0;
+  if (invalidate)
+    c.tags[slot] = NO_LINE;
+  return was_dirty;
+}
+
+void rv_cache_block_op(uint64_t, unsigned op, uint64_t addr)
+{
+  if (op == 0 || op > 3)
+    return;
+  block_ops[op]++;
+  /* Every copy is affected, including those in other harts' caches. */
+  bool invalidate = op != 1, discard = op == 3;
+  uint64_t line = addr >> line_exp;
+  bool dirty = false;
+  for (auto &c : l1i)
+    maintain(c, line, invalidate);
+  for (auto &c : l1d)
+    dirty |= maintain(c, line, invalidate);
+  for (auto &c : l2)
+    dirty |= maintain(c, line, invalidate);
+  if (dirty && !discard)
+    mem_writebacks++;
+}
+
+uint64_t rv_cache_cycles(void)
+{
+  return cycles;
+}
+
+static void report_cache(FILE *f, const cache &c)
+{
+  uint64_t n = c.reads + c.writes, misses = c.read_misses + c.write_misses;
+  fprintf(f,
+          "%-8s %10" PRIu64 " %4u %14" PRIu64 " %12" PRIu64 " %7.3f%% %12" PRIu64
+          " %12" PRIu64 " %12" PRIu64 "\n",
+          c.name.c_str(), (uint64_t)c.tags.size() << line_exp, c.ways, n,
+          misses, n ? 100.0 * misses / n : 0.0, c.read_misses, c.write_misses,
+          c.writebacks);
+}
+
+void rv_cache_write_report(const char *path)
+{
+  FILE *f = stderr;
+  if (path != NULL) {
+    f = fopen(path, "w");
+    if (f == NULL) {
+      fprintf(stderr, "Cannot open cache report '%s': %s\n", path,
+              strerror(errno));
+      return;
+    }
+  }
+  uint64_t total = accesses[0] + accesses[1] + accesses[2];
+  fprintf(f, "# %u byte lines, %s replacement, memory latency %u\n",
+          1u << line_exp, use_plru ? "pseudo-LRU" : "LRU", mem_latency);
+  fprintf(f,
+          "# %" PRIu64 " fetches, %" PRIu64 " loads, %" PRIu64 " stores; "
+          "%" PRIu64 " cbo.clean, %" PRIu64 " cbo.flush, %" PRIu64
+          " cbo.inval\n",
+          accesses[0], accesses[1], accesses[2], block_ops[1], block_ops[2],
+          block_ops[3]);
+  fprintf(f,
+          "# %" PRIu64 " estimated memory cycles (%.2f per access), %" PRIu64
+          " writebacks to memory\n",
+          cycles, total ? (double)cycles / total : 0.0, mem_writebacks);
+  fprintf(f, "%-8s %10s %4s %14s %12s %8s %12s %12s %12s\n", "cache", "size",
+          "ways", "accesses", "misses", "miss", "read-misses", "write-misses",
+          "writebacks");
+  for (const auto &c : l1i)
+    report_cache(f, c);
+  for (const auto &c : l1d)
+    report_cache(f, c);
+  for (const auto &c : l2)
+    report_cache(f, c);
+  if (f != stderr)
+    fclose(f);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Cache hierarchy model for first-order performance estimates.
+
+   When enabled, every physical RAM access made by the model (instruction
+   fetches, loads including page-table walks, stores, AMOs and cbo.zero) is
+   looked up in per-hart L1 instruction and data caches and an optional L2
+   shared by all harts. The caches are set-associative, write-back and
+   write-allocate, with LRU or tree pseudo-LRU replacement. The line size is
+   the cache block size. Each access is charged the latency of the level it
+   hits in, or the memory latency if it misses everywhere.
+
+   The model only keeps tags: data always comes from memory, and there is
+   no coherence between the harts' L1 caches. cbo.clean writes back a line,
+   cbo.flush writes it back and invalidates it, and cbo.inval discards it.
+ */
+
+/* Accesses as reported by the model. */
+enum rv_cache_access_kind {
+  RV_CACHE_FETCH = 0,
+  RV_CACHE_LOAD = 1,
+  RV_CACHE_STORE = 2,
+};
+
+/* Set when a configuration has been given; checked before every call into
+   the model so that it costs nothing when disabled. */
+extern bool rv_cache_enabled;
+
+/* Parses a configuration: a comma-separated list of
+     l1i=SIZE:WAYS[:LATENCY], l1d=SIZE:WAYS[:LATENCY], l2=SIZE:WAYS[:LATENCY],
+     mem=LATENCY, policy=lru|plru
+   where SIZE takes an optional K or M suffix. Caches that are not listed are
+   absent, and settings not listed take their defaults, whatever an earlier
+   call gave. Returns false after printing an error if the list is invalid. */
+bool rv_cache_configure(const char *config);
+
+/* Builds empty caches with 2^line_exp byte lines for `harts` harts,
+   replacing any earlier ones and clearing the statistics. Returns false
+   after printing an error if a cache's geometry is invalid. */
+bool rv_cache_init(unsigned line_exp, uint64_t harts);
+
+/* Flags returned by rv_cache_access. */
+enum rv_cache_miss {
+  RV_CACHE_L1_MISS = 1,  /* missed in the L1 cache */
+  RV_CACHE_MEM_MISS = 2, /* missed in every cache */
+};
+
+/* Looks up an access of `width` bytes at `addr`. Returns the rv_cache_miss
+   flags of the lines it touches. */
+unsigned rv_cache_access(uint64_t hart, unsigned kind, uint64_t addr,
+                         uint64_t width);
+
+/* A cbo.clean (1), cbo.flush (2) or cbo.inval (3) of the block at `addr`;
+   cbo.zero (0) is reported as a store instead. */
+void rv_cache_block_op(uint64_t hart, unsigned op, uint64_t addr);
+
+/* Estimated memory access cycles so far, for all harts. */
+uint64_t rv_cache_cycles(void);
+
+/* Writes the statistics of every cache to `path`, or to stderr if it is
+   NULL. */
+void rv_cache_write_report(const char *path);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
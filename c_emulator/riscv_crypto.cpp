@@ -0,0 +1,299 @@
+#include "riscv_crypto.h"
+
+/* _mm_cvtsi128_si64 only exists on x86-64. */
+#ifdef __x86_64__
+#include <immintrin.h>
+#define HAVE_AESNI_TARGET 1
+#endif
+
+/* S-boxes, as in riscv_types_kext.sail. */
+static const uint8_t aes_sbox_fwd[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b,
+    0xfe, 0xd7, 0xab, 0x76, 0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0, 0xb7, 0xfd, 0x93, 0x26,
+    0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2,
+    0xeb, 0x27, 0xb2, 0x75, 0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84, 0x53, 0xd1, 0x00, 0xed,
+    0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f,
+    0x50, 0x3c, 0x9f, 0xa8, 0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2, 0xcd, 0x0c, 0x13, 0xec,
+    0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14,
+    0xde, 0x5e, 0x0b, 0xdb, 0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79, 0xe7, 0xc8, 0x37, 0x6d,
+    0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f,
+    0x4b, 0xbd, 0x8b, 0x8a, 0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e, 0xe1, 0xf8, 0x98, 0x11,
+    0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f,
+    0xb0, 0x54, 0xbb, 0x16,
+};
+
+static const uint8_t aes_sbox_inv[256] = {
+    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e,
+    0x81, 0xf3, 0xd7, 0xfb, 0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87,
+    0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb, 0x54, 0x7b, 0x94, 0x32,
+    0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49,
+    0x6d, 0x8b, 0xd1, 0x25, 0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16,
+    0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92, 0x6c, 0x70, 0x48, 0x50,
+    0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05,
+    0xb8, 0xb3, 0x45, 0x06, 0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02,
+    0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b, 0x3a, 0x91, 0x11, 0x41,
+    0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8,
+    0x1c, 0x75, 0xdf, 0x6e, 0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89,
+    0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b, 0xfc, 0x56, 0x3e, 0x4b,
+    0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59,
+    0x27, 0x80, 0xec, 0x5f, 0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d,
+    0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef, 0xa0, 0xe0, 0x3b, 0x4d,
+    0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63,
+    0x55, 0x21, 0x0c, 0x7d,
+};
+
+static const uint8_t sm4_sbox[256] = {
+    0xd6, 0x90, 0xe9, 0xfe, 0xcc, 0xe1, 0x3d, 0xb7, 0x16, 0xb6, 0x14, 0xc2,
+    0x28, 0xfb, 0x2c, 0x05, 0x2b, 0x67, 0x9a, 0x76, 0x2a, 0xbe, 0x04, 0xc3,
+    0xaa, 0x44, 0x13, 0x26, 0x49, 0x86, 0x06, 0x99, 0x9c, 0x42, 0x50, 0xf4,
+    0x91, 0xef, 0x98, 0x7a, 0x33, 0x54, 0x0b, 0x43, 0xed, 0xcf, 0xac, 0x62,
+    0xe4, 0xb3, 0x1c, 0xa9, 0xc9, 0x08, 0xe8, 0x95, 0x80, 0xdf, 0x94, 0xfa,
+    0x75, 0x8f, 0x3f, 0xa6, 0x47, 0x07, 0xa7, 0xfc, 0xf3, 0x73, 0x17, 0xba,
+    0x83, 0x59, 0x3c, 0x19, 0xe6, 0x85, 0x4f, 0xa8, 0x68, 0x6b, 0x81, 0xb2,
+    0x71, 0x64, 0xda, 0x8b, 0xf8, 0xeb, 0x0f, 0x4b, 0x70, 0x56, 0x9d, 0x35,
+    0x1e, 0x24, 0x0e, 0x5e, 0x63, 0x58, 0xd1, 0xa2, 0x25, 0x22, 0x7c, 0x3b,
+    0x01, 0x21, 0x78, 0x87, 0xd4, 0x00, 0x46, 0x57, 0x9f, 0xd3, 0x27, 0x52,
+    0x4c, 0x36, 0x02, 0xe7, 0xa0, 0xc4, 0xc8, 0x9e, 0xea, 0xbf, 0x8a, 0xd2,
+    0x40, 0xc7, 0x38, 0xb5, 0xa3, 0xf7, 0xf2, 0xce, 0xf9, 0x61, 0x15, 0xa1,
+    0xe0, 0xae, 0x5d, 0xa4, 0x9b, 0x34, 0x1a, 0x55, 0xad, 0x93, 0x32, 0x30,
+    0xf5, 0x8c, 0xb1, 0xe3, 0x1d, 0xf6, 0xe2, 0x2e, 0x82, 0x66, 0xca, 0x60,
+    0xc0, 0x29, 0x23, 0xab, 0x0d, 0x53, 0x4e, 0x6f, 0xd5, 0xdb, 0x37, 0x45,
+    0xde, 0xfd, 0x8e, 0x2f, 0x03, 0xff, 0x6a, 0x72, 0x6d, 0x6c, 0x5b, 0x51,
+    0x8d, 0x1b, 0xaf, 0x92, 0xbb, 0xdd, 0xbc, 0x7f, 0x11, 0xd9, 0x5c, 0x41,
+    0x1f, 0x10, 0x5a, 0xd8, 0x0a, 0xc1, 0x31, 0x88, 0xa5, 0xcd, 0x7b, 0xbd,
+    0x2d, 0x74, 0xd0, 0x12, 0xb8, 0xe5, 0xb4, 0xb0, 0x89, 0x69, 0x97, 0x4a,
+    0x0c, 0x96, 0x77, 0x7e, 0x65, 0xb9, 0xf1, 0x09, 0xc5, 0x6e, 0xc6, 0x84,
+    0x18, 0xf0, 0x7d, 0xec, 0x3a, 0xdc, 0x4d, 0x20, 0x79, 0xee, 0x5f, 0x3e,
+    0xd7, 0xcb, 0x39, 0x48,
+};
+
+static inline uint32_t rol32(uint32_t x, unsigned n)
+{
+  n &= 31;
+  return n == 0 ? x : (x << n) | (x >> (32 - n));
+}
+
+static inline uint8_t xt2(uint8_t x)
+{
+  return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0x00));
+}
+
+static uint8_t gfmul(uint8_t x, unsigned y)
+{
+  uint8_t r = 0;
+  for (unsigned i = 0; i < 4; i++, x = xt2(x))
+    if (y & (1u << i))
+      r ^= x;
+  return r;
+}
+
+/* The MixColumn contribution of byte b in row 0 of a column, as in
+   aes_mixcolumn_byte_fwd/inv; other rows are rotations of it. */
+static inline uint32_t mix_fwd(uint8_t b)
+{
+  return (uint32_t)gfmul(b, 3) << 24 | (uint32_t)b << 16 | (uint32_t)b << 8
+       | gfmul(b, 2);
+}
+
+static inline uint32_t mix_inv(uint8_t b)
+{
+  return (uint32_t)gfmul(b, 0xb) << 24 | (uint32_t)gfmul(b, 0xd) << 16
+       | (uint32_t)gfmul(b, 0x9) << 8 | gfmul(b, 0xe);
+}
+
+struct crypto_tables {
+  uint32_t te[256];     /* mix_fwd(aes_sbox_fwd[b]) */
+  uint32_t td[256];     /* mix_inv(aes_sbox_inv[b]) */
+  uint32_t im[256];     /* mix_inv(b) */
+  uint32_t sm4_ed[256]; /* SM4 encrypt/decrypt transform of sm4_sbox[b] */
+  uint32_t sm4_ks[256]; /* SM4 key schedule transform of sm4_sbox[b] */
+
+  crypto_tables()
+  {
+    for (unsigned b = 0; b < 256; b++) {
+      te[b] = mix_fwd(aes_sbox_fwd[b]);
+      td[b] = mix_inv(aes_sbox_inv[b]);
+      im[b] = mix_inv((uint8_t)b);
+      uint32_t x = sm4_sbox[b];
+      sm4_ed[b] = x ^ (x << 8) ^ (x << 2) ^ (x << 18) ^ ((x & 0x3f) << 26)
+                ^ ((x & 0xc0) << 10);
+      sm4_ks[b] = x ^ ((x & 0x07) << 29) ^ ((x & 0xfe) << 7)
+                ^ ((x & 0x01) << 23) ^ ((x & 0xf8) << 13);
+    }
+  }
+};
+
+static const crypto_tables tables;
+
+static inline uint8_t byte_of(uint64_t x, unsigned i)
+{
+  return (uint8_t)(x >> (8 * i));
+}
+
+mach_bits rv_native_aes32(bool decrypt, bool mix, mach_bits bs, mach_bits rs1,
+                          mach_bits rs2)
+{
+  unsigned shamt = 8 * (bs & 3);
+  uint8_t si = byte_of(rs2, bs & 3);
+  uint32_t t;
+  if (mix)
+    t = decrypt ? tables.td[si] : tables.te[si];
+  else
+    t = decrypt ? aes_sbox_inv[si] : aes_sbox_fwd[si];
+  return (uint32_t)rs1 ^ rol32(t, shamt);
+}
+
+/* The bytes of the low half of the (inverse) ShiftRows of the state
+   rs2:rs1, in the order of aes_rv64_shiftrows_fwd/inv. */
+static inline void shiftrows(bool decrypt, uint64_t rs1, uint64_t rs2,
+                             uint8_t b[8])
+{
+  if (!decrypt) {
+    b[0] = byte_of(rs1, 0);
+    b[1] = byte_of(rs1, 5);
+    b[2] = byte_of(rs2, 2);
+    b[3] = byte_of(rs2, 7);
+    b[4] = byte_of(rs1, 4);
+    b[5] = byte_of(rs2, 1);
+    b[6] = byte_of(rs2, 6);
+    b[7] = byte_of(rs1, 3);
+  } else {
+    b[0] = byte_of(rs1, 0);
+    b[1] = byte_of(rs2, 5);
+    b[2] = byte_of(rs2, 2);
+    b[3] = byte_of(rs1, 7);
+    b[4] = byte_of(rs1, 4);
+    b[5] = byte_of(rs1, 1);
+    b[6] = byte_of(rs2, 6);
+    b[7] = byte_of(rs2, 3);
+  }
+}
+
+static uint64_t aes64_tables(bool decrypt, bool mix, uint64_t rs1,
+                             uint64_t rs2)
+{
+  uint8_t b[8];
+  shiftrows(decrypt, rs1, rs2, b);
+  uint64_t result = 0;
+  if (mix) {
+    const uint32_t *t = decrypt ? tables.td : tables.te;
+    for (unsigned c = 0; c < 2; c++) {
+      uint32_t col = t[b[4 * c]] ^ rol32(t[b[4 * c + 1]], 8)
+                   ^ rol32(t[b[4 * c + 2]], 16) ^ rol32(t[b[4 * c + 3]], 24);
+      result |= (uint64_t)col << (32 * c);
+    }
+  } else {
+    const uint8_t *sbox = decrypt ? aes_sbox_inv : aes_sbox_fwd;
+    for (unsigned i = 0; i < 8; i++)
+      result |= (uint64_t)sbox[b[i]] << (8 * i);
+  }
+  return result;
+}
+
+static uint64_t aes64_im_tables(uint64_t rs1)
+{
+  uint64_t result = 0;
+  for (unsigned c = 0; c < 2; c++) {
+    uint32_t col = 0;
+    for (unsigned i = 0; i < 4; i++)
+      col ^= rol32(tables.im[byte_of(rs1, 4 * c + i)], 8 * i);
+    result |= (uint64_t)col << (32 * c);
+  }
+  return result;
+}
+
+#ifdef HAVE_AESNI_TARGET
+/* AESENC/AESDEC perform a full round on the 128-bit state rs2:rs1, with
+   the same byte order as the RISC-V instructions; with a zero round key
+   the low half of the result is exactly aes64{e,d}s[m]. */
+__attribute__((target("aes,sse2"))) static uint64_t
+aes64_aesni(bool decrypt, bool mix, uint64_t rs1, uint64_t rs2)
+{
+  __m128i state = _mm_set_epi64x((long long)rs2, (long long)rs1);
+  __m128i zero = _mm_setzero_si128();
+  __m128i r;
+  if (decrypt)
+    r = mix ? _mm_aesdec_si128(state, zero) : _mm_aesdeclast_si128(state, zero);
+  else
+    r = mix ? _mm_aesenc_si128(state, zero) : _mm_aesenclast_si128(state, zero);
+  return (uint64_t)_mm_cvtsi128_si64(r);
+}
+
+__attribute__((target("aes,sse2"))) static uint64_t aes64_im_aesni(uint64_t rs1)
+{
+  return (uint64_t)_mm_cvtsi128_si64(
+      _mm_aesimc_si128(_mm_set_epi64x(0, (long long)rs1)));
+}
+#endif
+
+static bool have_aesni(void)
+{
+#ifdef HAVE_AESNI_TARGET
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("aes");
+#else
+  return false;
+#endif
+}
+
+static bool use_aesni = have_aesni();
+
+void rv_crypto_use_portable(void)
+{
+  use_aesni = false;
+}
+
+mach_bits rv_native_aes64(bool decrypt, bool mix, mach_bits rs1,
+                          mach_bits rs2)
+{
+#ifdef HAVE_AESNI_TARGET
+  if (use_aesni)
+    return aes64_aesni(decrypt, mix, rs1, rs2);
+#endif
+  return aes64_tables(decrypt, mix, rs1, rs2);
+}
+
+mach_bits rv_native_aes64_im(mach_bits rs1)
+{
+#ifdef HAVE_AESNI_TARGET
+  if (use_aesni)
+    return aes64_im_aesni(rs1);
+#endif
+  return aes64_im_tables(rs1);
+}
+
+mach_bits rv_native_aes64_ks1i(mach_bits rnum, mach_bits rs1)
+{
+  static const uint8_t rcon[10] = {0x01, 0x02, 0x04, 0x08, 0x10,
+                                   0x20, 0x40, 0x80, 0x1b, 0x36};
+  uint32_t prev = (uint32_t)(rs1 >> 32);
+  uint32_t subwords = 0;
+  for (unsigned i = 0; i < 4; i++)
+    subwords |= (uint32_t)aes_sbox_fwd[byte_of(prev, i)] << (8 * i);
+  uint32_t result = rnum == 0xa ? subwords
+                                : rol32(subwords, 24) ^ rcon[rnum < 10 ? rnum : 0];
+  return (uint64_t)result << 32 | result;
+}
+
+mach_bits rv_native_sm4(bool key_schedule, mach_bits bs, mach_bits rs1,
+                        mach_bits rs2)
+{
+  uint8_t si = byte_of(rs2, bs & 3);
+  uint32_t t = key_schedule ? tables.sm4_ks[si] : tables.sm4_ed[si];
+  return (uint32_t)rs1 ^ rol32(t, 8 * (bs & 3));
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "sail.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Native implementations of the scalar AES (Zkne/Zknd) and SM4 (Zksed)
+   instructions.
+
+   They are built on 32-bit T-tables combining the S-box with the
+   MixColumn (or SM4 linear transform) contribution of each byte, computed
+   once at startup from the S-boxes. The RV64 AES instructions use AES-NI
+   instead when the host CPU supports it. The reference definitions are in
+   riscv_insts_zkn.sail and riscv_insts_zks.sail.
+ */
+
+/* aes32{e,d}s[m]i: `decrypt` selects the inverse S-box and MixColumn, `mix`
+   the middle-round (m) form. */
+mach_bits rv_native_aes32(bool decrypt, bool mix, mach_bits bs, mach_bits rs1,
+                          mach_bits rs2);
+/* aes64{e,d}s[m] */
+mach_bits rv_native_aes64(bool decrypt, bool mix, mach_bits rs1,
+                          mach_bits rs2);
+mach_bits rv_native_aes64_im(mach_bits rs1);
+mach_bits rv_native_aes64_ks1i(mach_bits rnum, mach_bits rs1);
+
+/* sm4ed, or sm4ks if `key_schedule`. */
+mach_bits rv_native_sm4(bool key_schedule, mach_bits bs, mach_bits rs1,
+                        mach_bits rs2);
+
+/* Uses the T-tables for the RV64 AES instructions even on hosts with
+   AES-NI, so that both can be checked against the model. */
+void rv_crypto_use_portable(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
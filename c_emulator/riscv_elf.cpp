@@ -0,0 +1,258 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sail.h"
+#include "rts.h"
+#include "riscv_elf.h"
+#include "riscv_tags.h"
+
+/* The ELF structures, spelled out here because the Sail library ships its
+   own elf.h that shadows the system one. */
+
+#define EM_RISCV 243
+#define PT_LOAD 1
+#define SHT_SYMTAB 2
+#define STT_NOTYPE 0
+#define STT_FUNC 2
+
+struct elf32 {
+  struct ehdr {
+    unsigned char e_ident[16];
+    uint16_t e_type, e_machine;
+    uint32_t e_version, e_entry, e_phoff, e_shoff, e_flags;
+    uint16_t e_ehsize, e_phentsize, e_phnum, e_shentsize, e_shnum, e_shstrndx;
+  };
+  struct phdr {
+    uint32_t p_type, p_offset, p_vaddr, p_paddr, p_filesz, p_memsz, p_flags,
+        p_align;
+  };
+  struct shdr {
+    uint32_t sh_name, sh_type, sh_flags, sh_addr, sh_offset, sh_size, sh_link,
+        sh_info, sh_addralign, sh_entsize;
+  };
+  struct sym {
+    uint32_t st_name, st_value, st_size;
+    unsigned char st_info, st_other;
+    uint16_t st_shndx;
+  };
+};
+
+struct elf64 {
+  struct ehdr {
+    unsigned char e_ident[16];
+    uint16_t e_type, e_machine;
+    uint32_t e_version;
+    uint64_t e_entry, e_phoff, e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize, e_phentsize, e_phnum, e_shentsize, e_shnum, e_shstrndx;
+  };
+  struct phdr {
+    uint32_t p_type, p_flags;
+    uint64_t p_offset, p_vaddr, p_paddr, p_filesz, p_memsz, p_align;
+  };
+  struct shdr {
+    uint32_t sh_name, sh_type;
+    uint64_t sh_flags, sh_addr, sh_offset, sh_size;
+    uint32_t sh_link, sh_info;
+    uint64_t sh_addralign, sh_entsize;
+  };
+  struct sym {
+    uint32_t st_name;
+    unsigned char st_info, st_other;
+    uint16_t st_shndx;
+    uint64_t st_value, st_size;
+  };
+};
+
+struct rv_elf {
+  uint64_t entry;
+  std::unordered_map<std::string, uint64_t> symbols;
+  /* Function and untyped symbols, for symbolizing addresses. */
+  struct code_symbol {
+    std::string name;
+    uint64_t addr, size;
+  };
+  std::vector<code_symbol> code_symbols;
+};
+
+/* A bounds-checked view of the mapped file. */
+struct image {
+  const unsigned char *data;
+  uint64_t size;
+
+  bool contains(uint64_t off, uint64_t len) const
+  {
+    return off <= size && len <= size - off;
+  }
+
+  template <typename T> bool read(uint64_t off, T *out) const
+  {
+    if (!contains(off, sizeof(T)))
+      return false;
+    memcpy(out, data + off, sizeof(T));
+    return true;
+  }
+};
+
+/* Mapping symbols mark where code or data starts rather than naming a
+   function, and .L labels are branch targets inside one. */
+static bool is_marker_symbol(const std::string &name)
+{
+  return name[0] == '$' || name.compare(0, 2, ".L") == 0;
+}
+
+template <typename E>
+static const char *load(const image &img, bool zero_bss, rv_elf *elf)
+{
+  typename E::ehdr eh;
+  if (!img.read(0, &eh))
+    return "truncated ELF header";
+  if (eh.e_machine != EM_RISCV)
+    return "not a RISC-V ELF file";
+  elf->entry = eh.e_entry;
+  /* Entries may be larger than the structures we read, but not smaller. */
+  if (eh.e_phnum != 0 && eh.e_phentsize < sizeof(typename E::phdr))
+    return "bad program header size";
+  if (eh.e_shnum != 0 && eh.e_shentsize < sizeof(typename E::shdr))
+    return "bad section header size";
+
+  struct segment {
+    uint64_t addr, offset, filesz, memsz;
+  };
+  std::vector<segment> segments;
+  for (uint64_t i = 0; i < eh.e_phnum; i++) {
+    typename E::phdr ph;
+    if (!img.read(eh.e_phoff + i * eh.e_phentsize, &ph))
+      return "truncated program header";
+    if (ph.p_type != PT_LOAD || ph.p_memsz == 0)
+      continue;
+    if (ph.p_filesz > ph.p_memsz || !img.contains(ph.p_offset, ph.p_filesz))
+      return "segment extends past the end of the file";
+    segments.push_back({ph.p_paddr, ph.p_offset, ph.p_filesz, ph.p_memsz});
+  }
+
+  for (uint64_t i = 0; i < eh.e_shnum; i++) {
+    typename E::shdr sh, strtab;
+    if (!img.read(eh.e_shoff + i * eh.e_shentsize, &sh))
+      return "truncated section header";
+    if (sh.sh_type != SHT_SYMTAB)
+      continue;
+    if (!img.read(eh.e_shoff + (uint64_t)sh.sh_link * eh.e_shentsize, &strtab)
+        || !img.contains(strtab.sh_offset, strtab.sh_size)
+        || !img.contains(sh.sh_offset, sh.sh_size))
+      return "bad symbol table";
+    const char *names = (const char *)img.data + strtab.sh_offset;
+    for (uint64_t off = 0; off + sizeof(typename E::sym) <= sh.sh_size;
+         off += sizeof(typename E::sym)) {
+      typename E::sym sym;
+      img.read(sh.sh_offset + off, &sym);
+      if (sym.st_name == 0 || sym.st_name >= strtab.sh_size)
+        continue;
+      /* Not necessarily NUL-terminated if the file is corrupt. */
+      size_t len = strnlen(names + sym.st_name, strtab.sh_size - sym.st_name);
+      std::string name(names + sym.st_name, len);
+      unsigned type = sym.st_info & 0xf;
+      if ((type == STT_FUNC || type == STT_NOTYPE) && sym.st_shndx != 0
+          && sym.st_value != 0 && !is_marker_symbol(name))
+        elf->code_symbols.push_back({name, sym.st_value, sym.st_size});
+      elf->symbols.emplace(std::move(name), sym.st_value);
+    }
+  }
+
+  /* Only touch memory once the whole file has been validated. */
+  for (const segment &seg : segments) {
+    const unsigned char *src = img.data + seg.offset;
+    for (uint64_t j = 0; j < seg.filesz; j++)
+      write_mem(seg.addr + j, src[j]);
+    if (zero_bss) {
+      for (uint64_t j = seg.filesz; j < seg.memsz; j++)
+        write_mem(seg.addr + j, 0);
+    }
+    rv_clear_tag_range(seg.addr, seg.memsz);
+  }
+  return NULL;
+}
+
+rv_elf_t *rv_elf_load(const char *path, unsigned xlen, bool zero_bss,
+                      const char **error)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    *error = strerror(errno);
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    *error = strerror(errno);
+    close(fd);
+    return NULL;
+  }
+  if (st.st_size < 16) {
+    *error = "not an ELF file";
+    close(fd);
+    return NULL;
+  }
+  void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (m == MAP_FAILED) {
+    *error = strerror(errno);
+    return NULL;
+  }
+
+  image img = {(const unsigned char *)m, (uint64_t)st.st_size};
+  rv_elf *elf = new rv_elf();
+  const char *err = NULL;
+  if (memcmp(img.data, "\177ELF", 4) != 0)
+    err = "not an ELF file";
+  else if (img.data[5] != 1)
+    err = "not a little-endian ELF file";
+  else if (img.data[4] != (xlen == 32 ? 1 : 2))
+    err = xlen == 32 ? "64-bit ELF not supported by RV32 model"
+                     : "32-bit ELF not supported by RV64 model";
+  else if (xlen == 32)
+    err = load<elf32>(img, zero_bss, elf);
+  else
+    err = load<elf64>(img, zero_bss, elf);
+  munmap(m, st.st_size);
+
+  if (err != NULL) {
+    delete elf;
+    *error = err;
+    return NULL;
+  }
+  return elf;
+}
+
+void rv_elf_free(rv_elf_t *elf)
+{
+  delete elf;
+}
+
+uint64_t rv_elf_entry(const rv_elf_t *elf)
+{
+  return elf->entry;
+}
+
+bool rv_elf_lookup(const rv_elf_t *elf, const char *name, uint64_t *value)
+{
+  auto it = elf->symbols.find(name);
+  if (it == elf->symbols.end())
+    return false;
+  *value = it->second;
+  return true;
+}
+
+void rv_elf_for_each_code_symbol(const rv_elf_t *elf, rv_elf_symbol_fn fn,
+                                 void *arg)
+{
+  for (const auto &sym : elf->code_symbols)
+    fn(sym.name.c_str(), sym.addr, sym.size, arg);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ELF loading for the simulator and libsailriscv.
+
+   The file is mapped rather than read, and parsed once: the PT_LOAD
+   segments are copied into physical memory and the symbol table is indexed
+   by name, so looking up tohost and the signature symbols does not reopen
+   the file. Only little-endian RISC-V executables are accepted.
+ */
+
+typedef struct rv_elf rv_elf_t;
+
+/* Loads the segments of `path` into memory and clears the capability tags
+   they cover; the file's class must match `xlen`. Memory that has never
+   been written reads as zero, so the zero-initialised tail of each segment
+   (.bss) is only written when `zero_bss` is set, i.e. when the range may
+   hold earlier data. Returns NULL on error and points `*error` at a
+   message, in which case memory is left untouched. */
+rv_elf_t *rv_elf_load(const char *path, unsigned xlen, bool zero_bss,
+                      const char **error);
+void rv_elf_free(rv_elf_t *elf);
+
+uint64_t rv_elf_entry(const rv_elf_t *elf);
+
+/* Returns false if the symbol table has no symbol called `name`. */
+bool rv_elf_lookup(const rv_elf_t *elf, const char *name, uint64_t *value);
+
+/* Calls `fn` for every defined function or untyped symbol, the kinds that
+   label code, except mapping symbols ($x, $d, ...) and assembler-local
+   labels (.L...). `size` is 0 when the symbol table does not record one. */
+typedef void (*rv_elf_symbol_fn)(const char *name, uint64_t addr,
+                                 uint64_t size, void *arg);
+void rv_elf_for_each_code_symbol(const rv_elf_t *elf, rv_elf_symbol_fn fn,
+                                 void *arg);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
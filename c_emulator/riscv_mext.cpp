@@ -0,0 +1,86 @@
+#include "riscv_mext.h"
+
+static inline uint64_t width_mask(mach_int width)
+{
+  return width == 64 ? UINT64_MAX : (UINT64_C(1) << width) - 1;
+}
+
+/* Sign-extends the low `width` bits of `v`. */
+static inline int64_t sext(uint64_t v, mach_int width)
+{
+  return width == 64 ? (int64_t)v : (int64_t)(int32_t)(uint32_t)v;
+}
+
+/* High 64 bits of the unsigned 128-bit product. */
+static inline uint64_t mulhu64(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+  return (uint64_t)(((unsigned __int128)a * b) >> 64);
+#else
+  uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+  uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+  uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo;
+  uint64_t lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+  uint64_t mid = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+  return hi_hi + (hi_lo >> 32) + (mid >> 32);
+#endif
+}
+
+mach_bits rv_native_mul(mach_int width, mach_bits op, mach_bits a,
+                        mach_bits b)
+{
+  bool high = op != 0;
+  bool signed_a = op != 3;
+  bool signed_b = op < 2;
+
+  if (width == 32) {
+    /* The exact product of two 32-bit operands fits in 64 bits, and its low
+       64 bits are the same whether computed signed or unsigned. */
+    uint64_t x = signed_a ? (uint64_t)sext(a, 32) : (uint32_t)a;
+    uint64_t y = signed_b ? (uint64_t)sext(b, 32) : (uint32_t)b;
+    uint64_t p = x * y;
+    return (high ? p >> 32 : p) & width_mask(32);
+  }
+
+  if (!high)
+    return a * b;
+  /* The signed high product is the unsigned one minus the other operand
+     for each negative operand, as a - 2^64 is its two's complement value. */
+  uint64_t h = mulhu64(a, b);
+  if (signed_a && (int64_t)a < 0)
+    h -= b;
+  if (signed_b && (int64_t)b < 0)
+    h -= a;
+  return h;
+}
+
+mach_bits rv_native_div(mach_int width, bool is_signed, mach_bits a,
+                        mach_bits b)
+{
+  uint64_t mask = width_mask(width);
+  if ((b & mask) == 0)
+    return mask;
+  if (is_signed) {
+    int64_t x = sext(a, width), y = sext(b, width);
+    int64_t min = width == 64 ? INT64_MIN : INT32_MIN;
+    if (x == min && y == -1)
+      return a & mask;
+    return (uint64_t)(x / y) & mask;
+  }
+  return ((a & mask) / (b & mask)) & mask;
+}
+
+mach_bits rv_native_rem(mach_int width, bool is_signed, mach_bits a,
+                        mach_bits b)
+{
+  uint64_t mask = width_mask(width);
+  if ((b & mask) == 0)
+    return a & mask;
+  if (is_signed) {
+    int64_t x = sext(a, width), y = sext(b, width);
+    if (y == -1)
+      return 0;
+    return (uint64_t)(x % y) & mask;
+  }
+  return (a & mask) % (b & mask);
+}
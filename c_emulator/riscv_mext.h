@@ -0,0 +1,28 @@
+#pragma once
+#include "sail.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Native implementations of the M extension multiply and divide operations.
+
+   Operands and results occupy the low `width` bits (32 or 64) of a 64-bit
+   value; higher bits of the operands are ignored and those of the result
+   are zero. Division follows the RISC-V rules: a zero divisor gives a
+   quotient of all ones and a remainder equal to the dividend, and signed
+   overflow gives the dividend and a remainder of zero. The reference
+   definitions over unbounded integers are in riscv_insts_mext.sail.
+ */
+
+/* `op` is the funct3 encoding: 0 MUL, 1 MULH, 2 MULHSU, 3 MULHU. */
+mach_bits rv_native_mul(mach_int width, mach_bits op, mach_bits a,
+                        mach_bits b);
+mach_bits rv_native_div(mach_int width, bool is_signed, mach_bits a,
+                        mach_bits b);
+mach_bits rv_native_rem(mach_int width, bool is_signed, mach_bits a,
+                        mach_bits b);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
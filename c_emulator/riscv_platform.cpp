@@ -4,6 +4,8 @@
 #include "riscv_platform.h"
 #include "riscv_platform_impl.h"
 #include "riscv_sail.h"
+#include "riscv_cache.h"
+#include "riscv_timing.h"
 
 #ifdef DEBUG_RESERVATION
 #include <stdio.h>
@@ -15,8 +17,9 @@
 
 /* This file contains the definitions of the C externs of Sail model. */
 
-static mach_bits reservation = 0;
-static bool reservation_valid = false;
+/* One LR/SC reservation per hart. */
+static mach_bits reservation[RV_MAX_HARTS];
+static bool reservation_valid[RV_MAX_HARTS];
 
 bool sys_enable_rvc(unit)
 {
@@ -68,6 +71,31 @@ bool sys_enable_zicboz(unit)
   return rv_enable_zicboz;
 }
 
+bool sys_enable_zknd(unit)
+{
+  return rv_enable_zkn;
+}
+
+bool sys_enable_zkne(unit)
+{
+  return rv_enable_zkn;
+}
+
+bool sys_enable_zknh(unit)
+{
+  return rv_enable_zkn;
+}
+
+bool sys_enable_zksed(unit)
+{
+  return rv_enable_zks;
+}
+
+bool sys_enable_zksh(unit)
+{
+  return rv_enable_zks;
+}
+
 bool sys_enable_sstc(unit)
 {
   return rv_enable_sstc;
@@ -148,6 +176,29 @@ mach_bits plat_cache_block_size_exp(unit)
   return rv_cache_block_size_exp;
 }
 
+/* The Sail runtime only stores RAM a byte at a time, but this at least
+   avoids building a cache-block-sized bitvector of zeros in the model. */
+unit plat_zero_ram(mach_bits addr, mach_bits width)
+{
+  for (mach_bits i = 0; i < width; i++)
+    write_mem(addr + i, 0);
+  return UNIT;
+}
+
+unit plat_cache_block_op(mach_bits op, mach_bits addr)
+{
+  if (rv_cache_enabled)
+    rv_cache_block_op(rv_current_hart, op, addr);
+  return UNIT;
+}
+
+mach_bits plat_cache_access(mach_bits kind, mach_bits addr, mach_bits width)
+{
+  if (rv_cache_enabled)
+    return rv_cache_access(rv_current_hart, kind, addr, width);
+  return 0;
+}
+
 // Provides entropy for the scalar cryptography extension.
 mach_bits plat_get_16_random_bits(unit)
 {
@@ -164,11 +215,22 @@ mach_bits plat_clint_size(unit)
   return rv_clint_size;
 }
 
+mach_bits plat_revoker_base(unit)
+{
+  return rv_revoker_base;
+}
+
+mach_bits plat_revoker_size(unit)
+{
+  return rv_revoker_size;
+}
+
 unit load_reservation(mach_bits addr)
 {
-  reservation = addr;
-  reservation_valid = true;
-  RESERVATION_DBG("reservation <- %0" PRIx64 "\n", reservation);
+  reservation[rv_current_hart] = addr;
+  reservation_valid[rv_current_hart] = true;
+  RESERVATION_DBG("hart %" PRIu64 " reservation <- %0" PRIx64 "\n",
+                  rv_current_hart, addr);
   return UNIT;
 }
 
@@ -185,17 +247,56 @@ static mach_bits check_mask()
 bool match_reservation(mach_bits addr)
 {
   mach_bits mask = check_mask();
-  bool ret = reservation_valid && (reservation & mask) == (addr & mask);
-  RESERVATION_DBG("reservation(%c): %0" PRIx64 ", key=%0" PRIx64 ": %s\n",
-                  reservation_valid ? 'v' : 'i', reservation, addr,
+  bool valid = reservation_valid[rv_current_hart];
+  mach_bits res = reservation[rv_current_hart];
+  bool ret = valid && (res & mask) == (addr & mask);
+  RESERVATION_DBG("hart %" PRIu64 " reservation(%c): %0" PRIx64
+                  ", key=%0" PRIx64 ": %s\n",
+                  rv_current_hart, valid ? 'v' : 'i', res, addr,
                   ret ? "ok" : "fail");
   return ret;
 }
 
 unit cancel_reservation(unit)
 {
-  RESERVATION_DBG("reservation <- none\n");
-  reservation_valid = false;
+  RESERVATION_DBG("hart %" PRIu64 " reservation <- none\n", rv_current_hart);
+  reservation_valid[rv_current_hart] = false;
+  return UNIT;
+}
+
+bool rv_get_reservation(uint64_t *addr)
+{
+  *addr = reservation[rv_current_hart];
+  return reservation_valid[rv_current_hart];
+}
+
+void rv_set_reservation(bool valid, uint64_t addr)
+{
+  reservation[rv_current_hart] = addr;
+  reservation_valid[rv_current_hart] = valid;
+}
+
+/* A store to the cache block holding another hart's reservation breaks
+   that reservation. */
+unit cancel_other_reservations(mach_bits addr, mach_bits width)
+{
+  if (rv_hart_count == 1)
+    return UNIT;
+  unsigned shift = rv_cache_block_size_exp;
+  mach_bits mask = check_mask();
+  mach_bits first = (addr & mask) >> shift;
+  mach_bits last = ((addr + width - 1) & mask) >> shift;
+  for (uint64_t h = 0; h < rv_hart_count; h++) {
+    if (h == rv_current_hart || !reservation_valid[h])
+      continue;
+    mach_bits block = (reservation[h] & mask) >> shift;
+    if (block >= first && block <= last) {
+      RESERVATION_DBG("hart %" PRIu64 " reservation <- none (store by hart "
+                      "%" PRIu64 ")\n",
+                      h, rv_current_hart);
+      reservation_valid[h] = false;
+    }
+  }
   return UNIT;
 }
 
@@ -206,7 +307,42 @@ unit plat_term_write(mach_bits s)
   return UNIT;
 }
 
-void plat_insns_per_tick(sail_int *, unit) { }
+void plat_insns_per_tick(sail_int *rop, unit)
+{
+  CONVERT_OF(sail_int, mach_int)(rop, (mach_int)rv_insns_per_tick);
+}
+
+/* Skipping ahead in mtime is only safe when no other hart is running. */
+bool plat_wfi_fast_forward(unit)
+{
+  return rv_enable_wfi_fast_forward && rv_hart_count == 1;
+}
+
+/* A WFI skipped `insns` instructions: with the timing model they cost what
+   it charges for them, otherwise one cycle each. */
+void plat_wfi_cycles(sail_int *rop, sail_int insns)
+{
+  uint64_t n = (uint64_t)CONVERT_OF(mach_int, sail_int)(insns);
+  uint64_t cycles = rv_timing_enabled ? rv_timing_idle(n) : n;
+  CONVERT_OF(sail_int, mach_int)(rop, (mach_int)cycles);
+}
+
+unit plat_hart_yield(unit)
+{
+  rv_hart_yield = true;
+  return UNIT;
+}
+
+unit plat_nop_hint(mach_bits imm)
+{
+  rv_nop_hint = imm;
+  return UNIT;
+}
+
+void plat_hart_count(sail_int *rop, unit)
+{
+  CONVERT_OF(sail_int, mach_int)(rop, (mach_int)rv_hart_count);
+}
 
 mach_bits plat_htif_tohost(unit)
 {
@@ -1,5 +1,7 @@
 #pragma once
 #include "sail.h"
+#include "riscv_tags.h"
+#include "riscv_revoke.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -16,6 +18,11 @@ bool sys_enable_vext(unit);
 bool sys_enable_bext(unit);
 bool sys_enable_zicbom(unit);
 bool sys_enable_zicboz(unit);
+bool sys_enable_zknd(unit);
+bool sys_enable_zkne(unit);
+bool sys_enable_zknh(unit);
+bool sys_enable_zksed(unit);
+bool sys_enable_zksh(unit);
 bool sys_enable_sstc(unit);
 
 uint64_t sys_pmp_count(unit);
@@ -38,6 +45,9 @@ mach_bits plat_rom_base(unit);
 mach_bits plat_rom_size(unit);
 
 mach_bits plat_cache_block_size_exp(unit);
+unit plat_zero_ram(mach_bits addr, mach_bits width);
+unit plat_cache_block_op(mach_bits op, mach_bits addr);
+mach_bits plat_cache_access(mach_bits kind, mach_bits addr, mach_bits width);
 
 // Provides entropy for the scalar cryptography extension.
 mach_bits plat_get_16_random_bits(unit);
@@ -45,12 +55,21 @@ mach_bits plat_get_16_random_bits(unit);
 mach_bits plat_clint_base(unit);
 mach_bits plat_clint_size(unit);
 
+mach_bits plat_revoker_base(unit);
+mach_bits plat_revoker_size(unit);
+
 bool speculate_conditional(unit);
 unit load_reservation(mach_bits);
 bool match_reservation(mach_bits);
 unit cancel_reservation(unit);
+unit cancel_other_reservations(mach_bits, mach_bits);
 
 void plat_insns_per_tick(sail_int *rop, unit);
+bool plat_wfi_fast_forward(unit);
+void plat_wfi_cycles(sail_int *rop, sail_int insns);
+void plat_hart_count(sail_int *rop, unit);
+unit plat_hart_yield(unit);
+unit plat_nop_hint(mach_bits imm);
 
 unit plat_term_write(mach_bits);
 mach_bits plat_htif_tohost(unit);
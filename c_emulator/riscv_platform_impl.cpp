@@ -1,6 +1,14 @@
 #include "riscv_platform_impl.h"
 #include <unistd.h>
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sail.h"
+#include "rts.h"
+#include "riscv_sail.h"
+#include "riscv_tags.h"
 
 /* Settings of the platform implementation, with common defaults. */
 uint64_t rv_pmp_count = 0;
@@ -19,12 +27,15 @@ bool rv_enable_vext = true;
 bool rv_enable_bext = false;
 bool rv_enable_zicbom = false;
 bool rv_enable_zicboz = false;
+bool rv_enable_zkn = false;
+bool rv_enable_zks = false;
 bool rv_enable_sstc = false;
 
 bool rv_enable_dirty_update = false;
 bool rv_enable_misaligned = false;
 bool rv_mtval_has_illegal_inst_bits = false;
 bool rv_enable_writable_fiom = true;
+bool rv_enable_wfi_fast_forward = false;
 uint64_t rv_writable_hpm_counters = 0xFFFFFFFF;
 
 uint64_t rv_ram_base = UINT64_C(0x80000000);
@@ -38,27 +49,95 @@ bool rv_vext_vl_use_ceil = false;
 // Default 64, which is mandated by RVA22.
 uint64_t rv_cache_block_size_exp = UINT64_C(6);
 
-// Provides entropy for the scalar cryptography extension.
+uint64_t rv_entropy_seed = UINT64_C(0);
+bool rv_entropy_urandom = false;
+
+/* Output n of the SplitMix64 generator seeded with rv_entropy_seed. */
+static uint64_t entropy_prng(uint64_t n)
+{
+  uint64_t z = rv_entropy_seed + n * UINT64_C(0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return z ^ (z >> 31);
+}
+
+/* The next 64 bits from /dev/urandom, which is read 4 KiB at a time. */
+static uint64_t entropy_urandom(void)
+{
+  static const char *name = "/dev/urandom";
+  static FILE *f = NULL;
+  static uint64_t pool[512];
+  static size_t pool_pos = 512;
+
+  if (pool_pos == 512) {
+    if (f == NULL && (f = fopen(name, "rb")) == NULL) {
+      fprintf(stderr, "Cannot open %s: %s\n", name, strerror(errno));
+      exit(1);
+    }
+    if (fread(pool, sizeof(pool), 1, f) != 1) {
+      fprintf(stderr, "Unable to read from %s\n", name);
+      exit(1);
+    }
+    pool_pos = 0;
+  }
+  return pool[pool_pos++];
+}
+
+/* The position in the entropy stream: the 64-bit draws taken so far, and
+   the bits of the last one not yet handed out. */
+static uint64_t entropy_draws, entropy_bits;
+static unsigned entropy_left;
+
+// Provides entropy for the scalar cryptography extension, 16 bits at a time
+// out of each 64-bit draw.
 uint64_t rv_16_random_bits(void)
 {
-  // This function can be changed to support deterministic sequences of
-  // pseudo-random bytes. This is useful for testing.
-  const char *name = "/dev/urandom";
-  FILE *f = fopen(name, "rb");
-  uint16_t val;
-  if (fread(&val, 2, 1, f) != 1) {
-    fprintf(stderr, "Unable to read 2 bytes from %s\n", name);
+  if (entropy_left == 0) {
+    entropy_draws++;
+    entropy_bits = rv_entropy_urandom ? entropy_urandom()
+                                      : entropy_prng(entropy_draws);
+    entropy_left = 4;
   }
-  fclose(f);
-  return (uint64_t)val;
+  uint64_t val = entropy_bits & 0xffff;
+  entropy_bits >>= 16;
+  entropy_left--;
+  return val;
+}
+
+uint64_t rv_get_entropy_position(void)
+{
+  return entropy_draws * 4 - entropy_left;
+}
+
+void rv_set_entropy_position(uint64_t pos)
+{
+  entropy_draws = (pos + 3) / 4;
+  entropy_left = (unsigned)(entropy_draws * 4 - pos);
+  /* Bits from /dev/urandom cannot be drawn again. */
+  if (rv_entropy_urandom)
+    entropy_left = 0;
+  entropy_bits = entropy_left == 0
+      ? 0
+      : entropy_prng(entropy_draws) >> (16 * (4 - entropy_left));
 }
 
 uint64_t rv_clint_base = UINT64_C(0x2000000);
 uint64_t rv_clint_size = UINT64_C(0xc0000);
 
+// The revocation sweeper is only mapped when enabled.
+uint64_t rv_revoker_base = UINT64_C(0x3000000);
+uint64_t rv_revoker_size = UINT64_C(0);
+
 uint64_t rv_htif_tohost = UINT64_C(0x80001000);
 uint64_t rv_insns_per_tick = UINT64_C(100);
 
+uint64_t rv_nop_hint = 0;
+
+uint64_t rv_hart_count = 1;
+uint64_t rv_hart_quantum = UINT64_C(1000);
+uint64_t rv_current_hart = 0;
+bool rv_hart_yield = false;
+
 int term_fd = 1; // set during startup
 void plat_term_write_impl(char c)
 {
@@ -66,3 +145,75 @@ void plat_term_write_impl(char c)
     fprintf(stderr, "Unable to write to terminal!\n");
   }
 }
+
+bool rv_htif_poll(uint64_t *exit_code)
+{
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--)
+    v = (v << 8) | read_mem(rv_htif_tohost + i);
+  if ((v >> 48) != 0 || !(v & 1))
+    return false;
+  *exit_code = (v & UINT64_C(0xffffffffffff)) >> 1;
+  return true;
+}
+
+void rv_write_reset_vector(uint64_t entry, const unsigned char *dtb,
+                           size_t dtb_len)
+{
+#define RST_VEC_SIZE 8
+  uint32_t reset_vec[RST_VEC_SIZE]
+      = {0x297,                              // auipc  t0,0x0
+         0x28593 + (RST_VEC_SIZE * 4 << 20), // addi   a1, t0, &dtb
+         0xf1402573,                         // csrr   a0, mhartid
+         zxlen_val == 32 ? 0x0182a283u :     // lw     t0,24(t0)
+             0x0182b283u,                    // ld     t0,24(t0)
+         0x28067,                            // jr     t0
+         0,
+         (uint32_t)(entry & 0xffffffff),
+         (uint32_t)(entry >> 32)};
+
+  rv_rom_base = DEFAULT_RSTVEC;
+  uint64_t addr = rv_rom_base;
+  for (size_t i = 0; i < sizeof(reset_vec); i++)
+    write_mem(addr++, (uint64_t)((char *)reset_vec)[i]);
+
+  if (dtb && dtb_len) {
+    for (size_t i = 0; i < dtb_len; i++)
+      write_mem(addr++, dtb[i]);
+  }
+
+  /* zero-fill to page boundary */
+  const int align = 0x1000;
+  uint64_t rom_end = (addr + align - 1) / align * align;
+  for (uint64_t i = addr; i < rom_end; i++)
+    write_mem(addr++, 0);
+
+  /* set rom size */
+  rv_rom_size = rom_end - rv_rom_base;
+  /* the freshly written image carries no capabilities */
+  rv_clear_tag_range(rv_rom_base, rv_rom_size);
+  /* boot at reset vector */
+  zPC = rv_rom_base;
+}
+
+void rv_init_harts(void)
+{
+  zinit_harts(UNIT);
+  rv_current_hart = 0;
+}
+
+void rv_switch_hart(uint64_t h)
+{
+  zhart_switch(h);
+  rv_current_hart = h;
+  rv_hart_yield = false;
+}
+
+void rv_end_hart_round(void)
+{
+  /* The harts run side by side, so a round lasts one quantum. */
+  static uint64_t round_insns = 0;
+  round_insns += rv_hart_quantum;
+  zadvance_mtime(round_insns / rv_insns_per_tick);
+  round_insns %= rv_insns_per_tick;
+}
@@ -23,12 +23,15 @@ extern bool rv_enable_vext;
 extern bool rv_enable_bext;
 extern bool rv_enable_zicbom;
 extern bool rv_enable_zicboz;
+extern bool rv_enable_zkn;
+extern bool rv_enable_zks;
 extern bool rv_enable_sstc;
 extern bool rv_enable_writable_misa;
 extern bool rv_enable_dirty_update;
 extern bool rv_enable_misaligned;
 extern bool rv_mtval_has_illegal_inst_bits;
 extern bool rv_enable_writable_fiom;
+extern bool rv_enable_wfi_fast_forward;
 extern uint64_t rv_writable_hpm_counters;
 
 extern uint64_t rv_ram_base;
@@ -41,15 +44,71 @@ extern uint64_t rv_cache_block_size_exp;
 
 extern bool rv_vext_vl_use_ceil;
 
+/* Entropy for the Zkr seed CSR. By default it is a pseudo-random sequence
+   determined by rv_entropy_seed, so that runs are reproducible; if
+   rv_entropy_urandom is set it comes from /dev/urandom instead. */
+extern uint64_t rv_entropy_seed;
+extern bool rv_entropy_urandom;
+
 // Provides entropy for the scalar cryptography extension.
 extern uint64_t rv_16_random_bits(void);
 
+/* The number of 16-bit values taken from the entropy stream so far, and a
+   way back to that point, for model initialisation (0) and snapshots. */
+uint64_t rv_get_entropy_position(void);
+void rv_set_entropy_position(uint64_t pos);
+
 extern uint64_t rv_clint_base;
 extern uint64_t rv_clint_size;
 
+extern uint64_t rv_revoker_base;
+extern uint64_t rv_revoker_size;
+
 extern uint64_t rv_htif_tohost;
 extern uint64_t rv_insns_per_tick;
 
+/* The immediate of the last `c.nop imm` hint executed, or 0. Left for the
+   host to inspect and clear. */
+extern uint64_t rv_nop_hint;
+
+/* Multi-hart simulation. RV_MAX_HARTS must match max_harts in
+   riscv_platform.sail. Harts run round-robin, rv_hart_quantum steps at a
+   time or until they wait for an interrupt (rv_hart_yield);
+   rv_current_hart is the one whose state is in the model. */
+#define RV_MAX_HARTS 16
+extern uint64_t rv_hart_count;
+extern uint64_t rv_hart_quantum;
+extern uint64_t rv_current_hart;
+extern bool rv_hart_yield;
+
+/* Sets up rv_hart_count harts from the reset state and switches between
+   them. */
+void rv_init_harts(void);
+void rv_switch_hart(uint64_t h);
+
+/* Advances mtime after every hart has had its turn; with several harts this
+   is the only thing that moves the clock. */
+void rv_end_hart_round(void);
+
+/* The running hart's LR/SC reservation, which is kept outside the model;
+   for snapshots. */
+bool rv_get_reservation(uint64_t *addr);
+void rv_set_reservation(bool valid, uint64_t addr);
+
+/* The model has no HTIF device, so test programs signal completion by
+   writing an HTIF exit command (device and command 0, bit 0 set, the exit
+   code above it) to the tohost location in memory. Returns true, with the
+   exit code, once that has happened. Console output commands, which carry
+   a nonzero device, are ignored. */
+bool rv_htif_poll(uint64_t *exit_code);
+
+/* Writes the boot ROM at DEFAULT_RSTVEC: a reset vector that jumps to
+   `entry` with the hart id in a0 and the address of the device tree in a1,
+   followed by the device tree blob, if any. Sets rv_rom_base, rv_rom_size
+   and the PC. */
+void rv_write_reset_vector(uint64_t entry, const unsigned char *dtb,
+                           size_t dtb_len);
+
 extern FILE *trace_log;
 extern int term_fd;
 void plat_term_write_impl(char c);
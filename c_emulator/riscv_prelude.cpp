@@ -2,6 +2,14 @@
 #include "riscv_config.h"
 #include "riscv_platform_impl.h"
 
+bool config_print_instr = true;
+bool config_print_reg = true;
+bool config_print_mem_access = true;
+bool config_print_platform = true;
+bool config_print_step = false;
+
+FILE *trace_log = NULL;
+
 unit print_string(sail_string prefix, sail_string msg)
 {
   printf("%s%s\n", prefix, msg);
@@ -2,6 +2,9 @@
 #include "sail.h"
 #include "rts.h"
 #include "riscv_softfloat.h"
+#include "riscv_mext.h"
+#include "riscv_bitmanip.h"
+#include "riscv_crypto.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -0,0 +1,144 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "riscv_profile.h"
+
+/* Number of functions listed in the flat report. */
+#define PROFILE_TOP 50
+
+static uint64_t profile_period;
+static uint64_t total_samples;
+
+/* Sample counts by PC, one table per privilege level and CHERI mode. */
+static std::unordered_map<uint64_t, uint64_t> samples[4][2];
+
+struct symbol {
+  uint64_t addr, size;
+  std::string name;
+};
+static std::vector<symbol> symbols;
+
+void rv_profile_init(uint64_t period)
+{
+  profile_period = period;
+}
+
+void rv_profile_add_symbols(const rv_elf_t *elf)
+{
+  rv_elf_for_each_code_symbol(
+      elf,
+      [](const char *name, uint64_t addr, uint64_t size, void *) {
+        symbols.push_back({addr, size, name});
+      },
+      NULL);
+}
+
+void rv_profile_sample(uint64_t pc, unsigned privilege, bool cap_mode)
+{
+  samples[privilege & 3][cap_mode][pc]++;
+  total_samples++;
+}
+
+static const std::string unknown = "[unknown]";
+
+/* The symbol containing `pc`: the closest one at or below it, provided the
+   symbol's size (if known) covers `pc`. */
+static const std::string &symbolize(uint64_t pc)
+{
+  auto it = std::upper_bound(
+      symbols.begin(), symbols.end(), pc,
+      [](uint64_t pc, const symbol &s) { return pc < s.addr; });
+  if (it == symbols.begin())
+    return unknown;
+  --it;
+  if (it->size != 0 && pc - it->addr >= it->size)
+    return unknown;
+  return it->name;
+}
+
+static const char *privilege_name(unsigned p)
+{
+  static const char *names[] = {"U", "S", "H", "M"};
+  return names[p & 3];
+}
+
+void rv_profile_write(const char *path)
+{
+  /* Sized symbols first among those at the same address, so that e.g. a
+     function wins over a label at its entry. */
+  std::stable_sort(symbols.begin(), symbols.end(),
+                   [](const symbol &a, const symbol &b) {
+                     return a.addr < b.addr
+                         || (a.addr == b.addr && a.size > b.size);
+                   });
+  symbols.erase(std::unique(symbols.begin(), symbols.end(),
+                            [](const symbol &a, const symbol &b) {
+                              return a.addr == b.addr;
+                            }),
+                symbols.end());
+
+  std::map<std::string, uint64_t> by_function, folded;
+  uint64_t by_privilege[4] = {0}, by_mode[2] = {0};
+  for (unsigned p = 0; p < 4; p++) {
+    for (unsigned m = 0; m < 2; m++) {
+      for (const auto &s : samples[p][m]) {
+        const std::string &fn = symbolize(s.first);
+        by_function[fn] += s.second;
+        folded[std::string(privilege_name(p)) + (m ? ";cap;" : ";int;") + fn]
+            += s.second;
+        by_privilege[p] += s.second;
+        by_mode[m] += s.second;
+      }
+    }
+  }
+
+  FILE *f = fopen(path, "w");
+  if (f == NULL) {
+    fprintf(stderr, "Cannot open profile '%s': %s\n", path, strerror(errno));
+    return;
+  }
+  double total = total_samples ? (double)total_samples : 1.0;
+  fprintf(f, "# %" PRIu64 " samples, one every %" PRIu64 " instructions\n",
+          total_samples, profile_period);
+  fprintf(f, "# privilege:");
+  for (unsigned p = 0; p < 4; p++) {
+    if (by_privilege[p])
+      fprintf(f, " %s %.2f%%", privilege_name(p),
+              100.0 * by_privilege[p] / total);
+  }
+  fprintf(f, "\n# mode: cap %.2f%% int %.2f%%\n", 100.0 * by_mode[1] / total,
+          100.0 * by_mode[0] / total);
+
+  std::vector<std::pair<uint64_t, std::string>> flat;
+  for (const auto &s : by_function)
+    flat.push_back({s.second, s.first});
+  std::sort(flat.begin(), flat.end(), [](const auto &a, const auto &b) {
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+  });
+  if (flat.size() > PROFILE_TOP)
+    flat.resize(PROFILE_TOP);
+  fprintf(f, "%12s %7s  %s\n", "samples", "%", "function");
+  for (const auto &s : flat)
+    fprintf(f, "%12" PRIu64 " %7.2f  %s\n", s.first, 100.0 * s.first / total,
+            s.second.c_str());
+  fclose(f);
+
+  std::string folded_path = std::string(path) + ".folded";
+  f = fopen(folded_path.c_str(), "w");
+  if (f == NULL) {
+    fprintf(stderr, "Cannot open profile '%s': %s\n", folded_path.c_str(),
+            strerror(errno));
+    return;
+  }
+  for (const auto &s : folded)
+    fprintf(f, "%s %" PRIu64 "\n", s.first.c_str(), s.second);
+  fclose(f);
+}
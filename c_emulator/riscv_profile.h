@@ -0,0 +1,31 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "riscv_elf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Guest PC sampling.
+
+   The run loop takes a sample of the PC, privilege level and CHERI mode
+   every `period` retired instructions. At exit the samples are attributed
+   to the symbols of every loaded ELF file and written as a flat report of
+   the hottest functions, plus a file of folded stacks for flame graph
+   tools. The model does not track the guest call stack, so each folded
+   stack is privilege;mode;function.
+ */
+
+void rv_profile_init(uint64_t period);
+void rv_profile_add_symbols(const rv_elf_t *elf);
+void rv_profile_sample(uint64_t pc, unsigned privilege, bool cap_mode);
+
+/* Writes the flat report to `path` and the folded stacks to
+   `path`.folded. */
+void rv_profile_write(const char *path);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
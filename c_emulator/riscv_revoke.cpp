@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <iterator>
+#include <map>
+
+#include "sail.h"
+#include "riscv_sail.h"
+#include "riscv_revoke.h"
+
+/* Disjoint revoked intervals, keyed by base and mapping to top (exclusive).
+   Overlapping and adjacent intervals are merged on insertion so a lookup is a
+   single ordered search. */
+static std::map<uint64_t, uint64_t> revoked;
+
+bool plat_revoke_interval_hit(mach_bits addr)
+{
+  auto it = revoked.upper_bound(addr);
+  if (it == revoked.begin())
+    return false;
+  --it;
+  return addr < it->second;
+}
+
+unit plat_revoke_add_interval(mach_bits base, mach_bits top)
+{
+  if (base >= top)
+    return UNIT;
+
+  auto it = revoked.upper_bound(base);
+  if (it != revoked.begin() && std::prev(it)->second >= base) {
+    --it;
+    base = it->first;
+  }
+  while (it != revoked.end() && it->first <= top) {
+    top = std::max(top, it->second);
+    it = revoked.erase(it);
+  }
+  revoked[base] = top;
+  return UNIT;
+}
+
+unit plat_revoke_clear_intervals(unit)
+{
+  revoked.clear();
+  return UNIT;
+}
+
+void rv_revoke_add_interval(uint64_t base, uint64_t top)
+{
+  plat_revoke_add_interval(base, top);
+}
+
+void rv_revoke_clear_intervals(void)
+{
+  plat_revoke_clear_intervals(UNIT);
+}
+
+uint64_t rv_revoke_sweep(uint64_t start, uint64_t end)
+{
+  return zrevoke_sweep(start, end, false);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "sail.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Capability revocation.
+
+   The sweep itself lives in the model (model/cheri/cheri_revoke.sail) and is
+   exposed to the guest as a memory-mapped device. These are the externs it
+   uses for the host-maintained set of revoked intervals, along with a host
+   API so that an embedder can revoke without going through the guest. */
+
+bool plat_revoke_interval_hit(mach_bits addr);
+unit plat_revoke_add_interval(mach_bits base, mach_bits top);
+unit plat_revoke_clear_intervals(unit);
+
+/* Marks [base, top) as revoked for subsequent interval sweeps. */
+void rv_revoke_add_interval(uint64_t base, uint64_t top);
+void rv_revoke_clear_intervals(void);
+
+/* Sweeps the physical range [start, end), clearing the tag of every
+   capability whose base lies in a revoked interval. Returns the number of
+   capabilities revoked. */
+uint64_t rv_revoke_sweep(uint64_t start, uint64_t end);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
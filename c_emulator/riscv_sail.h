@@ -20,8 +20,33 @@ void model_fini(void);
 
 unit zinit_model(unit);
 bool zstep(sail_int);
-unit ztick_clock(unit);
+unit ztick_clock(mach_bits);
+unit zadvance_mtime(mach_bits);
 unit ztick_platform(unit);
+mach_bits zrevoke_sweep(mach_bits, mach_bits, bool);
+unit zinit_harts(unit);
+unit zhart_switch(mach_bits);
+unit zsnapshot_save(mach_bits);
+unit zsnapshot_restore(mach_bits);
+mach_bits zcheck_encdec_tree(mach_bits, mach_bits);
+mach_bits zcheck_encdec_compressed_tree(mach_bits, mach_bits);
+mach_bits zcheck_native(mach_bits, mach_bits);
+
+/* State accessors for libsailriscv (cheri_embed.sail). */
+mach_bits zembed_read_gpr(mach_bits);
+unit zembed_write_gpr(mach_bits, mach_bits);
+mach_bits zembed_read_pc(unit);
+unit zembed_write_pc(mach_bits);
+mach_bits zembed_read_privilege(unit);
+unit zembed_write_privilege(mach_bits);
+bool zembed_cap_mode(unit);
+bool zembed_read_cap_tag(mach_bits);
+mach_bits zembed_read_cap_metadata(mach_bits);
+mach_bits zembed_read_cap_address(mach_bits);
+unit zembed_write_cap(mach_bits, bool, mach_bits, mach_bits);
+bool zembed_csr_defined(mach_bits);
+mach_bits zembed_read_csr(mach_bits);
+mach_bits zembed_write_csr(mach_bits, mach_bits);
 
 #ifdef RVFI_DII
 unit zrvfi_set_instr_packet(mach_bits);
@@ -53,10 +78,8 @@ extern bool have_exception;
 extern uint32_t zcur_privilege;
 
 extern mach_bits zPC;
-
-extern mach_bits zx1, zx2, zx3, zx4, zx5, zx6, zx7, zx8, zx9, zx10, zx11, zx12,
-    zx13, zx14, zx15, zx16, zx17, zx18, zx19, zx20, zx21, zx22, zx23, zx24,
-    zx25, zx26, zx27, zx28, zx29, zx30, zx31;
+extern mach_bits zinstbits;
+extern mach_bits zretired_insts;
 
 extern mach_bits zmstatus;
 extern mach_bits zmepc, zmtval;
@@ -69,7 +92,6 @@ struct zMcause {
 };
 extern struct zMcause zmcause, zscause;
 
-extern mach_bits zminstret;
 
 #ifdef __cplusplus
 } // extern "C"
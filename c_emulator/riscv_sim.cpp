@@ -10,10 +10,14 @@
 #include <sys/mman.h>
 #include <sys/time.h>
 #include <sys/socket.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
 #include <netinet/ip.h>
 #include <fcntl.h>
 
-#include "elf.h"
 #include "sail.h"
 #include "rts.h"
 #ifdef SAILCOV
@@ -22,6 +26,14 @@
 #include "riscv_platform.h"
 #include "riscv_platform_impl.h"
 #include "riscv_sail.h"
+#include "riscv_config.h"
+#include "riscv_elf.h"
+#include "riscv_bitmanip.h"
+#include "riscv_crypto.h"
+#include "riscv_bbv.h"
+#include "riscv_profile.h"
+#include "riscv_cache.h"
+#include "riscv_timing.h"
 
 const char *RV64ISA = "RV64IMAC";
 const char *RV32ISA = "RV32IMAC";
@@ -52,14 +64,48 @@ enum {
   OPT_ENABLE_ZCB,
   OPT_ENABLE_ZICBOM,
   OPT_ENABLE_ZICBOZ,
+  OPT_ENABLE_ZKN,
+  OPT_ENABLE_ZKS,
   OPT_ENABLE_SSTC,
   OPT_CACHE_BLOCK_SIZE,
+  OPT_ENABLE_REVOKER,
+  OPT_WFI_FAST_FORWARD,
+  OPT_CHECK_DECODER,
+  OPT_CHECK_DECODER_SAMPLES,
+  OPT_CHECK_NATIVE,
+  OPT_NATIVE_PORTABLE,
+  OPT_HARTS,
+  OPT_HART_QUANTUM,
+  OPT_FF_UNTIL_PC,
+  OPT_FF_UNTIL_SYMBOL,
+  OPT_FF_UNTIL_INSNS,
+  OPT_FF_UNTIL_HINT,
+  OPT_BBV,
+  OPT_BBV_INTERVAL,
+  OPT_BBV_CHECKPOINT_DIR,
+  OPT_PROFILE,
+  OPT_PROFILE_PERIOD,
+  OPT_BENCH_JSON,
+  OPT_CACHE_MODEL,
+  OPT_CACHE_REPORT,
+  OPT_TIMING_MODEL,
+  OPT_TIMING_REPORT,
+  OPT_ENTROPY_SEED,
+  OPT_ENTROPY_URANDOM,
 };
 
 static bool do_show_times = false;
+static const char *bench_json_file = NULL;
+/* Whether the main ELF file has a tohost location to watch for exit. */
+static bool htif_enabled = false;
+static bool do_check_decoder = false;
+/* With --check-decoder-samples, the number of operand values checked for
+   each opcode/funct3/funct7 combination instead of every encoding. */
+static uint64_t check_decoder_samples = 0;
+/* Number of random operand pairs for --check-native. */
+static uint64_t check_native_count = 0;
 char *term_log = NULL;
 static const char *trace_log_path = NULL;
-FILE *trace_log = NULL;
 char *dtb_file = NULL;
 unsigned char *dtb = NULL;
 size_t dtb_len = 0;
@@ -72,17 +118,43 @@ static int rvfi_dii_port;
 static int rvfi_dii_sock;
 #endif
 
+/* Fast-forward: run with all tracing off until one of the enabled triggers
+   fires, then continue with the instrumentation requested on the command
+   line. */
+static bool ff_active = false;
+static bool ff_has_pc = false;
+static uint64_t ff_pc;
+static const char *ff_symbol = NULL;
+static uint64_t ff_symbol_pc; // ff_symbol's address once the ELF is loaded
+static uint64_t ff_insns = 0;
+static uint64_t ff_hint = 0;
+
+struct trace_config {
+  bool instr, reg, mem_access, platform, rvfi, step;
+};
+static struct trace_config ff_saved_config;
+
+/* SimPoint basic-block vector profiling. */
+static const char *bbv_file = NULL;
+static uint64_t bbv_interval = UINT64_C(100000000);
+static const char *bbv_checkpoint_dir = NULL;
+
+/* Guest PC sampling profiler. */
+static const char *profile_file = NULL;
+static uint64_t profile_period = UINT64_C(1000);
+
+/* Cache model report, written at exit if the model is enabled. */
+static const char *cache_report_file = NULL;
+
+/* Timing model report, written at exit if the model is enabled. */
+static const char *timing_report_file = NULL;
+
 char *sig_file = NULL;
 uint64_t mem_sig_start = 0;
 uint64_t mem_sig_end = 0;
 int signature_granularity = 4;
 
-bool config_print_instr = true;
-bool config_print_reg = true;
-bool config_print_mem_access = true;
-bool config_print_platform = true;
 bool config_print_rvfi = false;
-bool config_print_step = false;
 
 void set_config_print(char *var, bool val)
 {
@@ -150,7 +222,33 @@ static struct option options[] = {
     {"enable-zcb",                  no_argument,       0, OPT_ENABLE_ZCB          },
     {"enable-zicbom",               no_argument,       0, OPT_ENABLE_ZICBOM       },
     {"enable-zicboz",               no_argument,       0, OPT_ENABLE_ZICBOZ       },
+    {"enable-zkn",                  no_argument,       0, OPT_ENABLE_ZKN          },
+    {"enable-zks",                  no_argument,       0, OPT_ENABLE_ZKS          },
     {"cache-block-size",            required_argument, 0, OPT_CACHE_BLOCK_SIZE    },
+    {"enable-revoker",              no_argument,       0, OPT_ENABLE_REVOKER      },
+    {"enable-wfi-fast-forward",     no_argument,       0, OPT_WFI_FAST_FORWARD    },
+    {"check-decoder",               no_argument,       0, OPT_CHECK_DECODER       },
+    {"check-decoder-samples",       required_argument, 0, OPT_CHECK_DECODER_SAMPLES},
+    {"check-native",                required_argument, 0, OPT_CHECK_NATIVE        },
+    {"native-portable",             no_argument,       0, OPT_NATIVE_PORTABLE     },
+    {"harts",                       required_argument, 0, OPT_HARTS               },
+    {"hart-quantum",                required_argument, 0, OPT_HART_QUANTUM        },
+    {"ff-until-pc",                 required_argument, 0, OPT_FF_UNTIL_PC         },
+    {"ff-until-symbol",             required_argument, 0, OPT_FF_UNTIL_SYMBOL     },
+    {"ff-until-insns",              required_argument, 0, OPT_FF_UNTIL_INSNS      },
+    {"ff-until-hint",               required_argument, 0, OPT_FF_UNTIL_HINT       },
+    {"bbv",                         required_argument, 0, OPT_BBV                 },
+    {"bbv-interval",                required_argument, 0, OPT_BBV_INTERVAL        },
+    {"bbv-checkpoint-dir",          required_argument, 0, OPT_BBV_CHECKPOINT_DIR  },
+    {"profile",                     required_argument, 0, OPT_PROFILE             },
+    {"profile-period",              required_argument, 0, OPT_PROFILE_PERIOD      },
+    {"bench-json",                  required_argument, 0, OPT_BENCH_JSON          },
+    {"cache-model",                 required_argument, 0, OPT_CACHE_MODEL         },
+    {"cache-report",                required_argument, 0, OPT_CACHE_REPORT        },
+    {"timing-model",                required_argument, 0, OPT_TIMING_MODEL        },
+    {"timing-report",               required_argument, 0, OPT_TIMING_REPORT       },
+    {"entropy-seed",                required_argument, 0, OPT_ENTROPY_SEED        },
+    {"entropy-urandom",             no_argument,       0, OPT_ENTROPY_URANDOM     },
 #ifdef SAILCOV
     {"sailcov-file",                required_argument, 0, 'c'                     },
 #endif
@@ -180,11 +278,6 @@ static void report_arch(void)
   exit(0);
 }
 
-static bool is_32bit_model(void)
-{
-  return zxlen_val == 32;
-}
-
 static void read_dtb(const char *path)
 {
   int fd = open(path, O_RDONLY);
@@ -215,6 +308,20 @@ static void read_dtb(const char *path)
   fprintf(stdout, "Read %zd bytes of DTB from %s.\n", dtb_len, path);
 }
 
+static uint64_t parse_u64(const char *what, const char *arg)
+{
+  char *p;
+  unsigned long long val;
+  errno = 0;
+  val = strtoull(arg, &p, 0);
+  if (*arg == '\0' || *p != '\0' || val > UINT64_MAX
+      || (val == ULLONG_MAX && errno == ERANGE)) {
+    fprintf(stderr, "invalid %s %s\n", what, arg);
+    exit(1);
+  }
+  return val;
+}
+
 // Return log2(x), or -1 if x is not a power of 2.
 static int ilog2(uint64_t x)
 {
@@ -377,18 +484,9 @@ static int process_args(int argc, char **argv)
     case 'v':
       set_config_print(optarg, true);
       break;
-    case 'l': {
-      char *p;
-      unsigned long long val;
-      errno = 0;
-      val = strtoull(optarg, &p, 0);
-      if (*p != '\0' || val > UINT64_MAX
-          || (val == ULLONG_MAX && errno == ERANGE)) {
-        fprintf(stderr, "invalid instruction limit %s\n", optarg);
-        exit(1);
-      }
+    case 'l':
+      insn_limit = parse_u64("instruction limit", optarg);
       break;
-    }
     case OPT_ENABLE_SVINVAL:
       fprintf(stderr, "enabling svinval extension.\n");
       rv_enable_svinval = true;
@@ -405,6 +503,14 @@ static int process_args(int argc, char **argv)
       fprintf(stderr, "enabling Zicboz extension.\n");
       rv_enable_zicboz = true;
       break;
+    case OPT_ENABLE_ZKN:
+      fprintf(stderr, "enabling Zknd, Zkne and Zknh extensions.\n");
+      rv_enable_zkn = true;
+      break;
+    case OPT_ENABLE_ZKS:
+      fprintf(stderr, "enabling Zksed and Zksh extensions.\n");
+      rv_enable_zks = true;
+      break;
     case OPT_ENABLE_SSTC:
       fprintf(stderr, "enabling Sstc extension.\n");
       rv_enable_sstc = true;
@@ -421,6 +527,123 @@ static int process_args(int argc, char **argv)
               block_size_exp, 1 << block_size_exp);
       rv_cache_block_size_exp = block_size_exp;
       break;
+    case OPT_ENABLE_REVOKER:
+      fprintf(stderr, "enabling capability revocation sweeper at 0x%" PRIx64
+                      ".\n",
+              rv_revoker_base);
+      rv_revoker_size = UINT64_C(0x1000);
+      break;
+    case OPT_WFI_FAST_FORWARD:
+      fprintf(stderr,
+              "enabling WFI fast-forward to the next timer deadline.\n");
+      rv_enable_wfi_fast_forward = true;
+      break;
+    case OPT_CHECK_DECODER:
+      do_check_decoder = true;
+      break;
+    case OPT_CHECK_DECODER_SAMPLES:
+      do_check_decoder = true;
+      check_decoder_samples = parse_u64("sample count", optarg);
+      break;
+    case OPT_CHECK_NATIVE:
+      check_native_count = parse_u64("operand pair count", optarg);
+      break;
+    case OPT_NATIVE_PORTABLE:
+      fprintf(stderr, "using the portable native instruction implementations "
+                      "instead of host CPU extensions.\n");
+      rv_bitmanip_use_portable();
+      rv_crypto_use_portable();
+      break;
+    case OPT_HARTS:
+      rv_hart_count = atol(optarg);
+      if (rv_hart_count < 1 || rv_hart_count > RV_MAX_HARTS) {
+        fprintf(stderr, "invalid hart count '%s' provided (1 to %d).\n",
+                optarg, RV_MAX_HARTS);
+        exit(1);
+      }
+      fprintf(stderr, "simulating %" PRIu64 " harts.\n", rv_hart_count);
+      break;
+    case OPT_HART_QUANTUM:
+      rv_hart_quantum = atol(optarg);
+      if (rv_hart_quantum == 0) {
+        fprintf(stderr, "invalid hart quantum '%s' provided.\n", optarg);
+        exit(1);
+      }
+      fprintf(stderr, "switching harts every %" PRIu64 " steps.\n",
+              rv_hart_quantum);
+      break;
+    case OPT_FF_UNTIL_PC:
+      ff_pc = parse_u64("fast-forward PC", optarg);
+      ff_has_pc = ff_active = true;
+      break;
+    case OPT_FF_UNTIL_SYMBOL:
+      ff_symbol = optarg;
+      ff_active = true;
+      break;
+    case OPT_FF_UNTIL_INSNS:
+      ff_insns = parse_u64("fast-forward instruction count", optarg);
+      ff_active = true;
+      break;
+    case OPT_FF_UNTIL_HINT:
+      ff_hint = parse_u64("fast-forward hint", optarg);
+      if (ff_hint == 0 || ff_hint > 63) {
+        fprintf(stderr, "invalid fast-forward hint '%s' (1 to 63).\n",
+                optarg);
+        exit(1);
+      }
+      ff_active = true;
+      break;
+    case OPT_BBV:
+      bbv_file = optarg;
+      fprintf(stderr, "writing basic-block vectors to %s.\n", bbv_file);
+      break;
+    case OPT_BBV_INTERVAL:
+      bbv_interval = parse_u64("BBV interval", optarg);
+      if (bbv_interval == 0) {
+        fprintf(stderr, "invalid BBV interval '%s' provided.\n", optarg);
+        exit(1);
+      }
+      break;
+    case OPT_BBV_CHECKPOINT_DIR:
+      bbv_checkpoint_dir = optarg;
+      break;
+    case OPT_PROFILE:
+      profile_file = optarg;
+      fprintf(stderr, "writing a PC profile to %s.\n", profile_file);
+      break;
+    case OPT_PROFILE_PERIOD:
+      profile_period = parse_u64("profile period", optarg);
+      if (profile_period == 0) {
+        fprintf(stderr, "invalid profile period '%s' provided.\n", optarg);
+        exit(1);
+      }
+      break;
+    case OPT_BENCH_JSON:
+      bench_json_file = optarg;
+      break;
+    case OPT_CACHE_MODEL:
+      if (!rv_cache_configure(optarg))
+        exit(1);
+      fprintf(stderr, "enabling the cache model: %s.\n", optarg);
+      break;
+    case OPT_CACHE_REPORT:
+      cache_report_file = optarg;
+      break;
+    case OPT_TIMING_MODEL:
+      if (!rv_timing_configure(optarg))
+        exit(1);
+      fprintf(stderr, "enabling the timing model: %s.\n", optarg);
+      break;
+    case OPT_TIMING_REPORT:
+      timing_report_file = optarg;
+      break;
+    case OPT_ENTROPY_SEED:
+      rv_entropy_seed = parse_u64("entropy seed", optarg);
+      break;
+    case OPT_ENTROPY_URANDOM:
+      fprintf(stderr, "using /dev/urandom for the seed CSR.\n");
+      rv_entropy_urandom = true;
+      break;
     case 'x':
       fprintf(stderr, "enabling Zfinx support.\n");
       rv_enable_zfinx = true;
@@ -440,7 +663,39 @@ static int process_args(int argc, char **argv)
       break;
     }
   }
+  if (do_check_decoder || check_native_count > 0)
+    return optind;
+  if (bbv_file != NULL) {
+    if (rv_hart_count > 1) {
+      fprintf(stderr, "BBV profiling supports a single hart only.\n");
+      exit(1);
+    }
+    if (!rv_bbv_open(bbv_file, bbv_interval, bbv_checkpoint_dir))
+      exit(1);
+  } else if (bbv_checkpoint_dir != NULL) {
+    fprintf(stderr, "--bbv-checkpoint-dir requires --bbv.\n");
+    exit(1);
+  }
+  if (profile_file != NULL)
+    rv_profile_init(profile_period);
+  if (rv_cache_enabled) {
+    if (!rv_cache_init(rv_cache_block_size_exp, rv_hart_count))
+      exit(1);
+  } else if (cache_report_file != NULL) {
+    fprintf(stderr, "--cache-report requires --cache-model.\n");
+    exit(1);
+  }
+  if (rv_timing_enabled) {
+    rv_timing_init(rv_hart_count, zxlen_val);
+  } else if (timing_report_file != NULL) {
+    fprintf(stderr, "--timing-report requires --timing-model.\n");
+    exit(1);
+  }
 #ifdef RVFI_DII
+  if (rvfi_dii && ff_active) {
+    fprintf(stderr, "Fast-forward is not supported with RVFI-DII.\n");
+    exit(1);
+  }
   if (optind > argc || (optind == argc && !rvfi_dii))
     print_usage(argv[0], 0);
 #else
@@ -459,91 +714,59 @@ static int process_args(int argc, char **argv)
   return optind;
 }
 
-void check_elf(bool is32bit)
-{
-  if (is32bit) {
-    if (zxlen_val != 32) {
-      fprintf(stderr, "32-bit ELF not supported by RV%" PRIu64 " model.\n",
-              zxlen_val);
-      exit(1);
-    }
-  } else {
-    if (zxlen_val != 64) {
-      fprintf(stderr, "64-bit ELF not supported by RV%" PRIu64 " model.\n",
-              zxlen_val);
-      exit(1);
-    }
-  }
-}
 uint64_t load_sail(char *f, bool main_file)
 {
-  bool is32bit;
-  uint64_t entry;
-  uint64_t begin_sig, end_sig;
-  load_elf(f, &is32bit, &entry);
-  check_elf(is32bit);
+  const char *error;
+  /* The main file goes into untouched memory, where .bss already reads as
+     zero; additional files may overlap what was loaded before them. */
+  rv_elf_t *elf = rv_elf_load(f, zxlen_val, /*zero_bss=*/!main_file, &error);
+  if (elf == NULL) {
+    fprintf(stderr, "Unable to load ELF file %s: %s\n", f, error);
+    exit(1);
+  }
+  uint64_t entry = rv_elf_entry(elf);
+  if (profile_file != NULL)
+    rv_profile_add_symbols(elf);
   if (!main_file) {
     /* Don't scan for test-signature/htif symbols for additional ELF files. */
+    rv_elf_free(elf);
     return entry;
   }
   fprintf(stdout, "ELF Entry @ 0x%" PRIx64 "\n", entry);
+  uint64_t begin_sig, end_sig;
   /* locate htif ports */
-  if (lookup_sym(f, "tohost", &rv_htif_tohost) < 0) {
+  if (!rv_elf_lookup(elf, "tohost", &rv_htif_tohost)) {
     fprintf(stderr, "Unable to locate htif tohost port.\n");
     exit(1);
   }
   fprintf(stderr, "tohost located at 0x%0" PRIx64 "\n", rv_htif_tohost);
+  htif_enabled = true;
   /* locate test-signature locations if any */
-  if (!lookup_sym(f, "begin_signature", &begin_sig)) {
+  if (rv_elf_lookup(elf, "begin_signature", &begin_sig)) {
     fprintf(stdout, "begin_signature: 0x%0" PRIx64 "\n", begin_sig);
     mem_sig_start = begin_sig;
   }
-  if (!lookup_sym(f, "end_signature", &end_sig)) {
+  if (rv_elf_lookup(elf, "end_signature", &end_sig)) {
     fprintf(stdout, "end_signature: 0x%0" PRIx64 "\n", end_sig);
     mem_sig_end = end_sig;
   }
+  if (ff_symbol != NULL) {
+    if (!rv_elf_lookup(elf, ff_symbol, &ff_symbol_pc)) {
+      fprintf(stderr, "Unable to locate fast-forward symbol %s.\n",
+              ff_symbol);
+      exit(1);
+    }
+    fprintf(stderr, "fast-forwarding to %s at 0x%0" PRIx64 "\n", ff_symbol,
+            ff_symbol_pc);
+  }
+  rv_elf_free(elf);
   return entry;
 }
 
-void init_sail_reset_vector(uint64_t entry)
-{
-#define RST_VEC_SIZE 8
-  uint32_t reset_vec[RST_VEC_SIZE]
-      = {0x297,                              // auipc  t0,0x0
-         0x28593 + (RST_VEC_SIZE * 4 << 20), // addi   a1, t0, &dtb
-         0xf1402573,                         // csrr   a0, mhartid
-         is_32bit_model() ? 0x0182a283u :    // lw     t0,24(t0)
-             0x0182b283u,                    // ld     t0,24(t0)
-         0x28067,                            // jr     t0
-         0,
-         (uint32_t)(entry & 0xffffffff),
-         (uint32_t)(entry >> 32)};
-
-  rv_rom_base = DEFAULT_RSTVEC;
-  uint64_t addr = rv_rom_base;
-  for (size_t i = 0; i < sizeof(reset_vec); i++)
-    write_mem(addr++, (uint64_t)((char *)reset_vec)[i]);
-
-  if (dtb && dtb_len) {
-    for (size_t i = 0; i < dtb_len; i++)
-      write_mem(addr++, dtb[i]);
-  }
-
-  /* zero-fill to page boundary */
-  const int align = 0x1000;
-  uint64_t rom_end = (addr + align - 1) / align * align;
-  for (uint64_t i = addr; i < rom_end; i++)
-    write_mem(addr++, 0);
-
-  /* set rom size */
-  rv_rom_size = rom_end - rv_rom_base;
-  /* boot at reset vector */
-  zPC = rv_rom_base;
-}
-
 void init_sail(uint64_t elf_entry)
 {
   zinit_model(UNIT);
+  rv_set_entropy_position(0);
 #ifdef RVFI_DII
   if (rvfi_dii) {
     rv_ram_base = UINT64_C(0x80000000);
@@ -553,16 +776,19 @@ void init_sail(uint64_t elf_entry)
     rv_clint_base = UINT64_C(0);
     rv_clint_size = UINT64_C(0);
     rv_htif_tohost = UINT64_C(0);
+    rv_enable_wfi_fast_forward = false;
     zPC = elf_entry;
   } else
 #endif
-    init_sail_reset_vector(elf_entry);
+    rv_write_reset_vector(elf_entry, dtb, dtb_len);
+  rv_init_harts();
 }
 
 /* reinitialize to clear state and memory, typically across tests runs */
 void reinit_sail(uint64_t elf_entry)
 {
   model_fini();
+  rv_tags_reset();
   model_init();
   init_sail(elf_entry);
 }
@@ -606,27 +832,109 @@ void close_logs(void)
   }
 }
 
-void finish(int ec)
+/* Counts the instructions the host executes in user space for this
+   process, for --bench-json. Unavailable if the kernel does not allow it
+   (see perf_event_paranoid), in which case host_insn_fd stays -1. */
+static int host_insn_fd = -1;
+
+static void start_host_insn_counter(void)
 {
-  if (sig_file)
-    write_signature(sig_file);
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  host_insn_fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  if (host_insn_fd < 0) {
+    fprintf(stderr, "Host instruction counter unavailable: %s\n",
+            strerror(errno));
+    return;
+  }
+  ioctl(host_insn_fd, PERF_EVENT_IOC_RESET, 0);
+  ioctl(host_insn_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
 
-  model_fini();
+static bool read_host_insn_counter(uint64_t *count)
+{
+  if (host_insn_fd < 0)
+    return false;
+  bool ok = read(host_insn_fd, count, sizeof(*count)) == sizeof(*count);
+  close(host_insn_fd);
+  host_insn_fd = -1;
+  return ok;
+}
+
+static double elapsed_secs(const struct timeval *from, const struct timeval *to)
+{
+  return (double)(to->tv_sec - from->tv_sec)
+      + (double)(to->tv_usec - from->tv_usec) / 1e6;
+}
+
+static void write_bench_json(const char *file, double init_secs,
+                             double exec_secs, bool have_host_insns,
+                             uint64_t host_insns)
+{
+  FILE *f = fopen(file, "w");
+  if (!f) {
+    fprintf(stderr, "Cannot open file '%s': %s\n", file, strerror(errno));
+    return;
+  }
+  fprintf(f, "{\"instructions\": %" PRIu64 ", ", total_insns);
+  fprintf(f, "\"init_seconds\": %.6f, ", init_secs);
+  fprintf(f, "\"exec_seconds\": %.6f, ", exec_secs);
+  if (exec_secs > 0)
+    fprintf(f, "\"mips\": %.3f, ", total_insns / exec_secs / 1e6);
+  else
+    fprintf(f, "\"mips\": null, ");
+  if (have_host_insns && total_insns != 0)
+    fprintf(f,
+            "\"host_instructions\": %" PRIu64
+            ", \"host_insns_per_guest_insn\": %.1f}\n",
+            host_insns, (double)host_insns / total_insns);
+  else
+    fprintf(f, "\"host_instructions\": null, "
+               "\"host_insns_per_guest_insn\": null}\n");
+  fclose(f);
+}
+
+void finish(int ec)
+{
+  uint64_t host_insns = 0;
+  bool have_host_insns = read_host_insn_counter(&host_insns);
   if (gettimeofday(&run_end, NULL) < 0) {
     fprintf(stderr, "Cannot gettimeofday: %s\n", strerror(errno));
     exit(1);
   }
+
+  if (sig_file)
+    write_signature(sig_file);
+  rv_bbv_close();
+  if (profile_file != NULL)
+    rv_profile_write(profile_file);
+  if (rv_cache_enabled)
+    rv_cache_write_report(cache_report_file);
+  if (rv_timing_enabled)
+    rv_timing_write_report(timing_report_file);
+
+  model_fini();
+  double init_secs = elapsed_secs(&init_start, &init_end);
+  double exec_secs = elapsed_secs(&init_end, &run_end);
   if (do_show_times) {
-    int init_msecs = (init_end.tv_sec - init_start.tv_sec) * 1000
-        + (init_end.tv_usec - init_start.tv_usec) / 1000;
-    int exec_msecs = (run_end.tv_sec - init_end.tv_sec) * 1000
-        + (run_end.tv_usec - init_end.tv_usec) / 1000;
-    double Kips = ((double)total_insns) / ((double)exec_msecs);
-    fprintf(stderr, "Initialization:   %d msecs\n", init_msecs);
-    fprintf(stderr, "Execution:        %d msecs\n", exec_msecs);
+    fprintf(stderr, "Initialization:   %.0f msecs\n", init_secs * 1000);
+    fprintf(stderr, "Execution:        %.0f msecs\n", exec_secs * 1000);
     fprintf(stderr, "Instructions:     %" PRIu64 "\n", total_insns);
-    fprintf(stderr, "Perf:             %.3f Kips\n", Kips);
+    if (exec_secs > 0)
+      fprintf(stderr, "Perf:             %.3f Kips\n",
+              total_insns / exec_secs / 1000);
   }
+  if (bench_json_file != NULL)
+    write_bench_json(bench_json_file, init_secs, exec_secs, have_host_insns,
+                     host_insns);
   close_logs();
   exit(ec);
 }
@@ -698,6 +1006,47 @@ void rvfi_send_trace(unsigned version)
 
 #endif
 
+static void ff_begin(void)
+{
+  ff_saved_config = {config_print_instr, config_print_reg,
+                     config_print_mem_access, config_print_platform,
+                     config_print_rvfi, config_print_step};
+  config_print_instr = config_print_reg = config_print_mem_access = false;
+  config_print_platform = config_print_rvfi = config_print_step = false;
+  rv_nop_hint = 0;
+}
+
+static void ff_end(void)
+{
+  ff_active = false;
+  config_print_instr = ff_saved_config.instr;
+  config_print_reg = ff_saved_config.reg;
+  config_print_mem_access = ff_saved_config.mem_access;
+  config_print_platform = ff_saved_config.platform;
+  config_print_rvfi = ff_saved_config.rvfi;
+  config_print_step = ff_saved_config.step;
+  fprintf(stderr,
+          "fast-forward ended after %" PRIu64 " instructions at 0x%0" PRIx64
+          "\n",
+          total_insns, zPC);
+}
+
+/* Checked before each step, so a PC trigger fires before the instruction at
+   that address executes. */
+static bool ff_triggered(void)
+{
+  if (ff_has_pc && zPC == ff_pc)
+    return true;
+  if (ff_symbol != NULL && zPC == ff_symbol_pc)
+    return true;
+  if (ff_insns != 0 && total_insns >= ff_insns)
+    return true;
+  if (ff_hint != 0 && rv_nop_hint == ff_hint)
+    return true;
+  rv_nop_hint = 0;
+  return false;
+}
+
 void run_sail(void)
 {
   bool stepped;
@@ -707,17 +1056,36 @@ void run_sail(void)
   mach_int step_no = 0;
   int insn_cnt = 0;
 
+  uint64_t profile_cnt = 0;
+
+  /* round-robin hart scheduling; each hart keeps its own tick count */
+  uint64_t quantum_cnt = 0;
+  int hart_insn_cnt[RV_MAX_HARTS] = {0};
+
   struct timeval interval_start;
   if (gettimeofday(&interval_start, NULL) < 0) {
     fprintf(stderr, "Cannot gettimeofday: %s\n", strerror(errno));
     exit(1);
   }
 
-  // TODO: Not this.
   bool zhtif_done = false;
-  unsigned zhtif_exit_code = 1;
+  uint64_t zhtif_exit_code = 1;
+
+  if (ff_active)
+    ff_begin();
 
   while (!zhtif_done && (insn_limit == 0 || total_insns < insn_limit)) {
+    uint64_t step_pc = zPC;
+    uint64_t step_retired = zretired_insts;
+    /* Profile samples are attributed to the mode the instruction ran in,
+       not the one a trap or xRET left behind. Only read for the step that
+       will be sampled. */
+    unsigned step_priv = 0;
+    bool step_cap_mode = false;
+    if (profile_file != NULL && profile_cnt + 1 == profile_period) {
+      step_priv = zembed_read_privilege(UNIT);
+      step_cap_mode = zembed_cap_mode(UNIT);
+    }
 #ifdef RVFI_DII
     if (rvfi_dii) {
       mach_bits instr_bits;
@@ -821,6 +1189,8 @@ void run_sail(void)
     } else /* if (!rvfi_dii) */
 #endif
     { /* run a Sail step */
+      if (ff_active && ff_triggered())
+        ff_end();
       sail_int sail_step;
       CREATE(sail_int)(&sail_step);
       CONVERT_OF(sail_int, mach_int)(&sail_step, step_no);
@@ -837,6 +1207,15 @@ void run_sail(void)
       step_no++;
       insn_cnt++;
       total_insns++;
+      if (bbv_file != NULL)
+        rv_bbv_retire(step_pc, zPC, (uint32_t)zinstbits);
+      if (rv_timing_enabled)
+        rv_timing_retire(rv_current_hart, step_pc, zPC, (uint32_t)zinstbits,
+                         zretired_insts != step_retired);
+      if (profile_file != NULL && ++profile_cnt == profile_period) {
+        profile_cnt = 0;
+        rv_profile_sample(step_pc, step_priv, step_cap_mode);
+      }
     }
 
     if (do_show_times && (total_insns & 0xfffff) == 0) {
@@ -852,20 +1231,34 @@ void run_sail(void)
               ((uint64_t)1000) * 0x100000 / (end_us - start_us));
     }
 
+    if (insn_cnt == rv_insns_per_tick) {
+      insn_cnt = 0;
+      ztick_clock(rv_timing_enabled ? rv_timing_take_cycles(rv_current_hart)
+                                    : rv_insns_per_tick);
+      ztick_platform(UNIT);
+      if (htif_enabled)
+        zhtif_done = rv_htif_poll(&zhtif_exit_code);
+    }
+
     if (zhtif_done) {
       /* check exit code */
       if (zhtif_exit_code == 0) {
         fprintf(stdout, "SUCCESS\n");
       } else {
-        fprintf(stdout, "FAILURE: %" PRIi64 "\n", zhtif_exit_code);
-        exit(1);
+        fprintf(stdout, "FAILURE: %" PRIu64 "\n", zhtif_exit_code);
+        finish(1);
       }
     }
 
-    if (insn_cnt == rv_insns_per_tick) {
-      insn_cnt = 0;
-      ztick_clock(UNIT);
-      ztick_platform(UNIT);
+    if (rv_hart_count > 1
+        && (++quantum_cnt == rv_hart_quantum || rv_hart_yield)) {
+      quantum_cnt = 0;
+      hart_insn_cnt[rv_current_hart] = insn_cnt;
+      uint64_t next_hart = (rv_current_hart + 1) % rv_hart_count;
+      if (next_hart == 0)
+        rv_end_hart_round();
+      rv_switch_hart(next_hart);
+      insn_cnt = hart_insn_cnt[rv_current_hart];
     }
   }
 
@@ -906,6 +1299,99 @@ void init_logs()
 #endif
 }
 
+/* Compares the generated decision-tree decoders against the encdec
+   mappings on every 16-bit encoding, and on every 32-bit encoding or, with
+   --check-decoder-samples, a sample of them. */
+static int check_decoder(void)
+{
+  zinit_model(UNIT);
+  fprintf(stdout, "Checking 16-bit decoder.\n");
+  uint64_t mismatches = zcheck_encdec_compressed_tree(0, UINT64_C(1) << 16);
+  fprintf(stdout, "Checking 32-bit decoder.\n");
+  if (check_decoder_samples == 0) {
+    mismatches += zcheck_encdec_tree(0, UINT64_C(1) << 32);
+  } else {
+    /* The tree branches on opcode, funct3 and funct7, so every combination
+       of those is visited, with the remaining (register and immediate)
+       bits all clear, all set, and then random. */
+    const uint64_t operands = UINT64_C(0x01ff8f80);
+    uint64_t state = UINT64_C(0x5eed);
+    for (uint64_t k = 0; k < (UINT64_C(1) << 17); k++) {
+      uint64_t fixed = (k & 0x7f) | ((k >> 7 & 7) << 12) | ((k >> 10) << 25);
+      for (uint64_t s = 0; s < check_decoder_samples; s++) {
+        uint64_t fill;
+        if (s == 0) {
+          fill = 0;
+        } else if (s == 1) {
+          fill = operands;
+        } else {
+          /* splitmix64, with a fixed seed so that failures are
+             reproducible. */
+          uint64_t z = (state += UINT64_C(0x9e3779b97f4a7c15));
+          z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+          z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+          fill = (z ^ (z >> 31)) & operands;
+        }
+        mismatches += zcheck_encdec_tree(fixed | fill, (fixed | fill) + 1);
+      }
+    }
+  }
+  fprintf(stdout, "%" PRIu64 " mismatching encodings.\n", mismatches);
+  model_fini();
+  close_logs();
+  return mismatches == 0 ? 0 : 1;
+}
+
+/* Compares native implementations of instructions against their reference
+   definitions (check_native in riscv_native_c.sail) on every pair of
+   boundary operands and on `count` random pairs. */
+static int check_native(uint64_t count)
+{
+  static const uint64_t boundary[] = {
+      0,
+      1,
+      2,
+      3,
+      UINT64_C(0x7fffffff),
+      UINT64_C(0x80000000),
+      UINT64_C(0xfffffffe),
+      UINT64_C(0xffffffff),
+      UINT64_C(0x100000000),
+      UINT64_C(0x7fffffffffffffff),
+      UINT64_C(0x8000000000000000),
+      UINT64_C(0xfffffffffffffffe),
+      UINT64_C(0xffffffffffffffff),
+  };
+  const size_t n_boundary = sizeof(boundary) / sizeof(boundary[0]);
+  uint64_t mismatches = 0;
+
+  zinit_model(UNIT);
+  for (size_t i = 0; i < n_boundary; i++)
+    for (size_t j = 0; j < n_boundary; j++)
+      mismatches += zcheck_native(boundary[i], boundary[j]);
+
+  /* splitmix64, with a fixed seed so that failures are reproducible. Each
+     operand is shifted right by a random amount so that small magnitudes
+     (non-trivial quotients, long runs of leading zeros) are well covered. */
+  uint64_t state = UINT64_C(0x5eed);
+  auto next = [&state]() {
+    uint64_t z = (state += UINT64_C(0x9e3779b97f4a7c15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return z ^ (z >> 31);
+  };
+  for (uint64_t k = 0; k < count; k++) {
+    uint64_t r = next();
+    uint64_t a = next() >> (r & 63);
+    uint64_t b = next() >> ((r >> 6) & 63);
+    mismatches += zcheck_native(a, b);
+  }
+  fprintf(stdout, "%" PRIu64 " mismatching operations.\n", mismatches);
+  model_fini();
+  close_logs();
+  return mismatches == 0 ? 0 : 1;
+}
+
 int main(int argc, char **argv)
 {
   model_init();
@@ -914,6 +1400,11 @@ int main(int argc, char **argv)
   char *initial_elf_file = argv[files_start];
   init_logs();
 
+  if (do_check_decoder)
+    return check_decoder();
+  if (check_native_count > 0)
+    return check_native(check_native_count);
+
   if (gettimeofday(&init_start, NULL) < 0) {
     fprintf(stderr, "Cannot gettimeofday: %s\n", strerror(errno));
     exit(1);
@@ -990,6 +1481,8 @@ int main(int argc, char **argv)
 
   init_sail(entry);
 
+  if (bench_json_file != NULL)
+    start_host_insn_counter();
   if (gettimeofday(&init_end, NULL) < 0) {
     fprintf(stderr, "Cannot gettimeofday: %s\n", strerror(errno));
     exit(1);
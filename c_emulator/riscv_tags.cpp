@@ -0,0 +1,160 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+
+#include "sail.h"
+#include "riscv_platform_impl.h"
+#include "riscv_sail.h"
+#include "riscv_tags.h"
+
+/* Dense tag bitmap covering the RAM window, allocated on the first tag write
+   so that the window reflects the final RAM configuration. */
+static uint64_t *ram_tags = NULL;
+static uint64_t ram_tags_first = 0; // granule index of the first RAM granule
+static uint64_t ram_tags_count = 0; // number of RAM granules
+
+/* Tags outside the RAM window, ordered so that a range can be found with a
+   single search. */
+static std::set<uint64_t> other_tags;
+
+static unsigned tag_granule_log2(void)
+{
+  return zxlen_val == 32 ? 3 : 4;
+}
+
+static void alloc_ram_tags(void)
+{
+  unsigned shift = tag_granule_log2();
+  ram_tags_first = rv_ram_base >> shift;
+  ram_tags_count = rv_ram_size >> shift;
+  ram_tags = (uint64_t *)calloc((ram_tags_count + 63) / 64, sizeof(uint64_t));
+  if (ram_tags == NULL) {
+    fprintf(stderr, "Cannot allocate tag bitmap for %" PRIu64 " granules!\n",
+            ram_tags_count);
+    exit(1);
+  }
+}
+
+static bool in_ram_tags(uint64_t tag_addr)
+{
+  return ram_tags != NULL && tag_addr - ram_tags_first < ram_tags_count;
+}
+
+bool plat_read_tag(mach_bits tag_addr)
+{
+  if (in_ram_tags(tag_addr)) {
+    uint64_t i = tag_addr - ram_tags_first;
+    return (ram_tags[i / 64] >> (i % 64)) & 1;
+  }
+  return other_tags.count(tag_addr) != 0;
+}
+
+unit plat_write_tag(mach_bits tag_addr, bool tag)
+{
+  if (ram_tags == NULL && tag)
+    alloc_ram_tags();
+  if (in_ram_tags(tag_addr)) {
+    uint64_t i = tag_addr - ram_tags_first;
+    uint64_t bit = UINT64_C(1) << (i % 64);
+    if (tag)
+      ram_tags[i / 64] |= bit;
+    else
+      ram_tags[i / 64] &= ~bit;
+  } else if (tag) {
+    other_tags.insert(tag_addr);
+  } else {
+    other_tags.erase(tag_addr);
+  }
+  return UNIT;
+}
+
+unit plat_clear_tags(mach_bits tag_addr, mach_bits count)
+{
+  uint64_t end = tag_addr + count;
+
+  if (end > tag_addr)
+    other_tags.erase(other_tags.lower_bound(tag_addr),
+                     other_tags.lower_bound(end));
+
+  if (ram_tags == NULL)
+    return UNIT;
+
+  uint64_t ram_end = ram_tags_first + ram_tags_count;
+  uint64_t lo = tag_addr > ram_tags_first ? tag_addr : ram_tags_first;
+  uint64_t hi = end < ram_end ? end : ram_end;
+  if (lo >= hi)
+    return UNIT;
+
+  uint64_t i = lo - ram_tags_first;
+  uint64_t n = hi - lo;
+  /* Leading partial word, whole words, then trailing partial word. */
+  if (i % 64 != 0) {
+    uint64_t bits = 64 - i % 64 < n ? 64 - i % 64 : n;
+    uint64_t mask = (bits == 64 ? ~UINT64_C(0) : (UINT64_C(1) << bits) - 1)
+        << (i % 64);
+    ram_tags[i / 64] &= ~mask;
+    i += bits;
+    n -= bits;
+  }
+  if (n >= 64) {
+    memset(&ram_tags[i / 64], 0, (n / 64) * sizeof(uint64_t));
+    i += n & ~UINT64_C(63);
+    n %= 64;
+  }
+  if (n != 0)
+    ram_tags[i / 64] &= ~((UINT64_C(1) << n) - 1);
+  return UNIT;
+}
+
+void rv_clear_tag_range(uint64_t addr, uint64_t len)
+{
+  if (len == 0)
+    return;
+  unsigned shift = tag_granule_log2();
+  uint64_t first = addr >> shift;
+  uint64_t last = (addr + len - 1) >> shift;
+  plat_clear_tags(first, last - first + 1);
+}
+
+mach_bits plat_tag_next_set(mach_bits from, mach_bits to)
+{
+  uint64_t found = to;
+
+  auto it = other_tags.lower_bound(from);
+  if (it != other_tags.end() && *it < found)
+    found = *it;
+
+  if (ram_tags == NULL || ram_tags_count == 0)
+    return found;
+
+  /* Clip [from, found) against the RAM window and scan word by word. */
+  uint64_t ram_end = ram_tags_first + ram_tags_count;
+  uint64_t lo = from > ram_tags_first ? from : ram_tags_first;
+  uint64_t hi = found < ram_end ? found : ram_end;
+  if (lo >= hi)
+    return found;
+
+  uint64_t i = lo - ram_tags_first;
+  uint64_t end = hi - ram_tags_first;
+  uint64_t word = ram_tags[i / 64] & (~UINT64_C(0) << (i % 64));
+  while (true) {
+    if (word != 0) {
+      uint64_t hit = (i & ~UINT64_C(63)) + __builtin_ctzll(word);
+      return hit < end ? ram_tags_first + hit : found;
+    }
+    i = (i & ~UINT64_C(63)) + 64;
+    if (i >= end)
+      return found;
+    word = ram_tags[i / 64];
+  }
+}
+
+void rv_tags_reset(void)
+{
+  free(ram_tags);
+  ram_tags = NULL;
+  ram_tags_first = 0;
+  ram_tags_count = 0;
+  other_tags.clear();
+}
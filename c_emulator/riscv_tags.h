@@ -0,0 +1,36 @@
+#pragma once
+#include "sail.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Capability tag storage.
+
+   Tags are addressed by granule index (physical address >> log2_cap_size),
+   exactly as passed by the model to MEMr_tag/MEMw_tag. Granules that fall in
+   RAM are kept in a dense bitmap so that whole words of tags can be scanned
+   or cleared at once; the few tagged granules elsewhere (e.g. ROM) live in a
+   sparse set.
+ */
+
+bool plat_read_tag(mach_bits tag_addr);
+unit plat_write_tag(mach_bits tag_addr, bool tag);
+
+/* Clears `count` consecutive tags starting at `tag_addr`. */
+unit plat_clear_tags(mach_bits tag_addr, mach_bits count);
+
+/* Clears the tags of every granule overlapping the bytes [addr, addr + len),
+   e.g. when the host loads an image into memory. */
+void rv_clear_tag_range(uint64_t addr, uint64_t len);
+
+/* Returns the index of the first set tag in [from, to), or `to` if there is
+   none. */
+mach_bits plat_tag_next_set(mach_bits from, mach_bits to);
+
+/* Drops all tags, typically when the model is reinitialized. */
+void rv_tags_reset(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,581 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "riscv_cache.h"
+#include "riscv_timing.h"
+
+bool rv_timing_enabled = false;
+
+enum insn_class {
+  CLASS_ALU,
+  CLASS_MUL,
+  CLASS_DIV,
+  CLASS_LOAD,
+  CLASS_STORE,
+  CLASS_AMO,
+  CLASS_BRANCH,
+  CLASS_JUMP,
+  CLASS_FP,
+  CLASS_FDIV,
+  CLASS_VECTOR,
+  CLASS_SYSTEM,
+  NUM_CLASSES
+};
+
+static const char *class_names[NUM_CLASSES] = {
+    "alu",    "mul", "div", "load", "store",  "amo",
+    "branch", "jump", "fp", "fdiv", "vector", "system",
+};
+static unsigned class_latency[NUM_CLASSES] = {1, 3, 20, 2, 1, 10,
+                                              1, 1, 4,  20, 4, 5};
+
+enum predictor_kind { PRED_BIMODAL, PRED_GSHARE, PRED_TAGE };
+static const char *predictor_names[3] = {"bimodal", "gshare", "tage"};
+
+/* Configuration. */
+static predictor_kind predictor = PRED_GSHARE;
+static unsigned bp_bits = 12, history_bits = 12, ras_entries = 16;
+static unsigned btb_bits = 9, mispredict_penalty = 8, trap_penalty = 20;
+static unsigned model_xlen;
+
+/* The TAGE-like predictor has a bimodal base table and tagged tables using
+   geometrically longer histories, each a quarter of the size of the base. */
+#define TAGE_TABLES 4
+#define TAGE_TAG_BITS 9
+#define TAGE_NO_TAG 0xffff
+#define TAGE_AGE_PERIOD (UINT64_C(1) << 18)
+static const unsigned tage_history[TAGE_TABLES] = {4, 11, 27, 64};
+
+struct tage_entry {
+  uint16_t tag;
+  int8_t ctr; /* -4..3, predicts taken if >= 0 */
+  uint8_t u;  /* usefulness, 0..3 */
+};
+
+struct hart_timing {
+  std::vector<uint8_t> counters; /* 2-bit counters */
+  std::vector<tage_entry> tagged[TAGE_TABLES];
+  uint64_t history, tage_updates;
+  std::vector<uint64_t> ras;
+  unsigned ras_pos, ras_count;
+  std::vector<uint64_t> btb;
+  uint64_t cycles, taken;
+};
+
+static std::vector<hart_timing> harts;
+static uint64_t last_cache_cycles;
+
+/* Statistics, for all harts. */
+static uint64_t class_insns[NUM_CLASSES], class_cycles[NUM_CLASSES];
+static uint64_t branches, branch_misses, returns, return_misses;
+static uint64_t indirect_jumps, indirect_misses, traps, idle_insns;
+static uint64_t mispredict_cycles, trap_cycles, memory_cycles, idle_cycles;
+static uint64_t total_cycles;
+
+static bool parse_unsigned(const char *s, unsigned *v)
+{
+  char *end;
+  errno = 0;
+  unsigned long n = strtoul(s, &end, 0);
+  if (errno != 0 || end == s || *end != '\0' || n > UINT32_MAX)
+    return false;
+  *v = (unsigned)n;
+  return true;
+}
+
+static bool parse_item(const std::string &item)
+{
+  size_t eq = item.find('=');
+  if (eq == std::string::npos)
+    return false;
+  std::string key = item.substr(0, eq), value = item.substr(eq + 1);
+  if (key == "predictor") {
+    for (unsigned i = 0; i < 3; i++) {
+      if (value == predictor_names[i]) {
+        predictor = (predictor_kind)i;
+        return true;
+      }
+    }
+    return false;
+  }
+  if (key == "bp-bits")
+    return parse_unsigned(value.c_str(), &bp_bits) && bp_bits >= 4
+        && bp_bits <= 24;
+  if (key == "history")
+    return parse_unsigned(value.c_str(), &history_bits) && history_bits <= 64;
+  if (key == "ras")
+    return parse_unsigned(value.c_str(), &ras_entries);
+  if (key == "btb-bits")
+    return parse_unsigned(value.c_str(), &btb_bits) && btb_bits <= 24;
+  if (key == "mispredict")
+    return parse_unsigned(value.c_str(), &mispredict_penalty);
+  if (key == "trap")
+    return parse_unsigned(value.c_str(), &trap_penalty);
+  for (unsigned i = 0; i < NUM_CLASSES; i++) {
+    if (key == class_names[i])
+      return parse_unsigned(value.c_str(), &class_latency[i]);
+  }
+  return false;
+}
+
+bool rv_timing_configure(const char *spec)
+{
+  std::string s(spec);
+  size_t start = 0;
+  while (start < s.size()) {
+    size_t comma = s.find(',', start);
+    if (comma == std::string::npos)
+      comma = s.size();
+    std::string item = s.substr(start, comma - start);
+    if (!parse_item(item)) {
+      fprintf(stderr, "invalid timing model item '%s'.\n", item.c_str());
+      return false;
+    }
+    start = comma + 1;
+  }
+  rv_timing_enabled = true;
+  return true;
+}
+
+void rv_timing_init(uint64_t count, unsigned xlen)
+{
+  model_xlen = xlen;
+  harts.assign(count, hart_timing());
+  for (auto &t : harts) {
+    t.counters.assign(size_t(1) << bp_bits, 1);
+    if (predictor == PRED_TAGE) {
+      for (auto &table : t.tagged)
+        table.assign(size_t(1) << (bp_bits - 2), {TAGE_NO_TAG, 0, 0});
+    }
+    t.history = t.tage_updates = 0;
+    t.ras.assign(ras_entries, 0);
+    t.ras_pos = t.ras_count = 0;
+    t.btb.assign(size_t(1) << btb_bits, 0);
+    t.cycles = t.taken = 0;
+  }
+  last_cache_cycles = rv_cache_enabled ? rv_cache_cycles() : 0;
+}
+
+/* Classification by encoding. */
+
+/* Vector loads and stores share the FP opcodes, with these widths. */
+static bool is_vector_width(unsigned funct3)
+{
+  return funct3 == 0 || funct3 >= 5;
+}
+
+static insn_class classify_compressed(uint32_t insn)
+{
+  unsigned funct3 = (insn >> 13) & 7;
+  switch (insn & 3) {
+  case 0:
+    if (funct3 == 0)
+      return CLASS_ALU; /* c.addi4spn */
+    if (funct3 == 4) /* Zcb: c.lbu, c.lhu, c.lh, c.sb, c.sh */
+      return ((insn >> 10) & 3) < 2 ? CLASS_LOAD : CLASS_STORE;
+    return funct3 < 4 ? CLASS_LOAD : CLASS_STORE;
+  case 1:
+    if (funct3 == 5 || (funct3 == 1 && model_xlen == 32))
+      return CLASS_JUMP; /* c.j, c.jal */
+    if (funct3 >= 6)
+      return CLASS_BRANCH;
+    if (funct3 == 4 && ((insn >> 10) & 0x3f) == 0x27 && ((insn >> 5) & 3) == 2)
+      return CLASS_MUL; /* c.mul */
+    return CLASS_ALU;
+  default:
+    if (funct3 == 4) {
+      unsigned rs1 = (insn >> 7) & 31, rs2 = (insn >> 2) & 31;
+      if (rs2 != 0)
+        return CLASS_ALU; /* c.mv, c.add */
+      if (insn & 0x1000)
+        return rs1 == 0 ? CLASS_SYSTEM : CLASS_JUMP; /* c.ebreak, c.jalr */
+      return CLASS_JUMP;                             /* c.jr */
+    }
+    if (funct3 == 0)
+      return CLASS_ALU; /* c.slli */
+    return funct3 < 4 ? CLASS_LOAD : CLASS_STORE;
+  }
+}
+
+static insn_class classify(uint32_t insn)
+{
+  if ((insn & 3) != 3)
+    return classify_compressed(insn & 0xffff);
+  unsigned funct3 = (insn >> 12) & 7;
+  switch (insn & 0x7f) {
+  case 0x03:
+    return CLASS_LOAD;
+  case 0x07:
+    return is_vector_width(funct3) ? CLASS_VECTOR : CLASS_LOAD;
+  case 0x23:
+    return CLASS_STORE;
+  case 0x27:
+    return is_vector_width(funct3) ? CLASS_VECTOR : CLASS_STORE;
+  case 0x2f:
+    return CLASS_AMO;
+  case 0x33:
+  case 0x3b:
+    if ((insn >> 25) == 1)
+      return funct3 < 4 ? CLASS_MUL : CLASS_DIV;
+    return CLASS_ALU;
+  case 0x43:
+  case 0x47:
+  case 0x4b:
+  case 0x4f:
+    return CLASS_FP;
+  case 0x53: {
+    unsigned funct5 = insn >> 27;
+    return funct5 == 0x03 || funct5 == 0x0b ? CLASS_FDIV : CLASS_FP;
+  }
+  case 0x57:
+    return funct3 == 7 ? CLASS_ALU : CLASS_VECTOR; /* vset{i}vl{i} */
+  case 0x63:
+    return CLASS_BRANCH;
+  case 0x67:
+  case 0x6f:
+    return CLASS_JUMP;
+  case 0x0f:
+  case 0x73:
+    return CLASS_SYSTEM;
+  default:
+    return CLASS_ALU;
+  }
+}
+
+/* The link and source registers of a jump, and whether it is indirect. */
+static bool jump_regs(uint32_t insn, unsigned *rd, unsigned *rs1)
+{
+  if ((insn & 3) != 3) {
+    if ((insn & 3) == 1) { /* c.j, c.jal */
+      *rd = ((insn >> 13) & 7) == 1 ? 1 : 0;
+      return false;
+    }
+    *rd = (insn & 0x1000) ? 1 : 0; /* c.jalr, c.jr */
+    *rs1 = (insn >> 7) & 31;
+    return true;
+  }
+  *rd = (insn >> 7) & 31;
+  *rs1 = (insn >> 15) & 31;
+  return (insn & 0x7f) == 0x67;
+}
+
+static bool is_link(unsigned r)
+{
+  return r == 1 || r == 5;
+}
+
+/* Branch direction prediction. */
+
+static void counter_update(uint8_t &c, bool taken)
+{
+  if (taken) {
+    if (c < 3)
+      c++;
+  } else if (c > 0) {
+    c--;
+  }
+}
+
+/* Folds the last `length` bits of history into `bits` bits. */
+static uint64_t fold(uint64_t history, unsigned length, unsigned bits)
+{
+  uint64_t h
+      = length >= 64 ? history : history & ((UINT64_C(1) << length) - 1);
+  uint64_t mask = (UINT64_C(1) << bits) - 1, folded = 0;
+  for (; h != 0; h >>= bits)
+    folded ^= h & mask;
+  return folded;
+}
+
+/* Predicts the branch at `pc`, trains on its outcome and returns whether it
+   was mispredicted. */
+static bool tage_predict(hart_timing &t, uint64_t pc, bool taken)
+{
+  uint64_t p = pc >> 1;
+  unsigned index_bits = bp_bits - 2;
+  uint64_t index_mask = (UINT64_C(1) << index_bits) - 1;
+  size_t index[TAGE_TABLES];
+  uint16_t tag[TAGE_TABLES];
+  int provider = -1, alt = -1;
+  for (int i = TAGE_TABLES - 1; i >= 0; i--) {
+    index[i] = (p ^ (p >> index_bits)
+                ^ fold(t.history, tage_history[i], index_bits))
+        & index_mask;
+    tag[i] = (p ^ fold(t.history, tage_history[i], TAGE_TAG_BITS)
+              ^ (fold(t.history, tage_history[i], TAGE_TAG_BITS - 1) << 1))
+        & ((1u << TAGE_TAG_BITS) - 1);
+    if (t.tagged[i][index[i]].tag == tag[i]) {
+      if (provider < 0)
+        provider = i;
+      else if (alt < 0)
+        alt = i;
+    }
+  }
+
+  uint8_t &base = t.counters[p & ((UINT64_C(1) << bp_bits) - 1)];
+  bool base_pred = base >= 2;
+  bool alt_pred = alt >= 0 ? t.tagged[alt][index[alt]].ctr >= 0 : base_pred;
+  bool pred = base_pred;
+  if (provider >= 0) {
+    tage_entry &e = t.tagged[provider][index[provider]];
+    pred = e.ctr >= 0;
+    if (pred != alt_pred) {
+      if (pred == taken && e.u < 3)
+        e.u++;
+      else if (pred != taken && e.u > 0)
+        e.u--;
+    }
+    if (taken && e.ctr < 3)
+      e.ctr++;
+    else if (!taken && e.ctr > -4)
+      e.ctr--;
+  } else {
+    counter_update(base, taken);
+  }
+
+  /* On a misprediction, try to allocate an entry with a longer history. */
+  if (pred != taken && provider < TAGE_TABLES - 1) {
+    bool allocated = false;
+    for (int j = provider + 1; j < TAGE_TABLES && !allocated; j++) {
+      tage_entry &e = t.tagged[j][index[j]];
+      if (e.u == 0) {
+        e = {tag[j], int8_t(taken ? 0 : -1), 0};
+        allocated = true;
+      }
+    }
+    if (!allocated) {
+      for (int j = provider + 1; j < TAGE_TABLES; j++) {
+        if (t.tagged[j][index[j]].u > 0)
+          t.tagged[j][index[j]].u--;
+      }
+    }
+  }
+
+  /* Age the usefulness counters so that stale entries can be replaced. */
+  if (++t.tage_updates % TAGE_AGE_PERIOD == 0) {
+    for (auto &table : t.tagged) {
+      for (auto &e : table)
+        e.u >>= 1;
+    }
+  }
+  return pred != taken;
+}
+
+static bool predict_branch(hart_timing &t, uint64_t pc, bool taken)
+{
+  bool missed;
+  uint64_t mask = (UINT64_C(1) << bp_bits) - 1;
+  switch (predictor) {
+  case PRED_BIMODAL: {
+    uint8_t &c = t.counters[(pc >> 1) & mask];
+    missed = (c >= 2) != taken;
+    counter_update(c, taken);
+    break;
+  }
+  case PRED_GSHARE: {
+    uint8_t &c
+        = t.counters[((pc >> 1) ^ fold(t.history, history_bits, bp_bits))
+                     & mask];
+    missed = (c >= 2) != taken;
+    counter_update(c, taken);
+    break;
+  }
+  default:
+    missed = tage_predict(t, pc, taken);
+    break;
+  }
+  t.history = (t.history << 1) | (taken ? 1 : 0);
+  return missed;
+}
+
+/* Return address stack. */
+
+static void ras_push(hart_timing &t, uint64_t addr)
+{
+  if (ras_entries == 0)
+    return;
+  t.ras_pos = (t.ras_pos + 1) % ras_entries;
+  t.ras[t.ras_pos] = addr;
+  if (t.ras_count < ras_entries)
+    t.ras_count++;
+}
+
+/* Returns the predicted return address, or 1 (never a valid target) if the
+   stack is empty. */
+static uint64_t ras_pop(hart_timing &t)
+{
+  if (t.ras_count == 0)
+    return 1;
+  uint64_t addr = t.ras[t.ras_pos];
+  t.ras_pos = (t.ras_pos + ras_entries - 1) % ras_entries;
+  t.ras_count--;
+  return addr;
+}
+
+/* Predicts the target of a jump and returns whether it was mispredicted.
+   Direct jumps are assumed to be redirected early enough to cost nothing
+   more than their latency. The link register conventions are those of the
+   unprivileged specification. */
+static bool predict_jump(hart_timing &t, uint32_t insn, uint64_t pc,
+                         uint64_t fallthrough, uint64_t next_pc)
+{
+  unsigned rd = 0, rs1 = 0;
+  bool indirect = jump_regs(insn, &rd, &rs1);
+  if (!indirect) {
+    if (is_link(rd))
+      ras_push(t, fallthrough);
+    return false;
+  }
+  if (is_link(rs1) && !(is_link(rd) && rd == rs1)) {
+    /* A return, or a coroutine swap if rd is also a link. */
+    returns++;
+    bool missed = ras_pop(t) != next_pc;
+    if (is_link(rd))
+      ras_push(t, fallthrough);
+    return_misses += missed;
+    return missed;
+  }
+  if (is_link(rd))
+    ras_push(t, fallthrough);
+  indirect_jumps++;
+  uint64_t &target = t.btb[(pc >> 1) & ((UINT64_C(1) << btb_bits) - 1)];
+  bool missed = target != next_pc;
+  target = next_pc;
+  indirect_misses += missed;
+  return missed;
+}
+
+/* The cycles of an instruction that retired, training the predictors. */
+static uint64_t retired_cycles(hart_timing &t, uint64_t pc, uint64_t next_pc,
+                               uint32_t insn)
+{
+  insn_class c = classify(insn);
+  uint64_t fallthrough = pc + ((insn & 3) == 3 ? 4 : 2);
+  uint64_t cycles = class_latency[c];
+
+  class_insns[c]++;
+  class_cycles[c] += cycles;
+  if (c == CLASS_BRANCH) {
+    branches++;
+    if (predict_branch(t, pc, next_pc != fallthrough)) {
+      branch_misses++;
+      mispredict_cycles += mispredict_penalty;
+      cycles += mispredict_penalty;
+    }
+  } else if (c == CLASS_JUMP) {
+    if (predict_jump(t, insn, pc, fallthrough, next_pc)) {
+      mispredict_cycles += mispredict_penalty;
+      cycles += mispredict_penalty;
+    }
+  } else if (next_pc != fallthrough) {
+    /* An xRET. */
+    traps++;
+    trap_cycles += trap_penalty;
+    cycles += trap_penalty;
+  }
+  return cycles;
+}
+
+void rv_timing_retire(uint64_t hart, uint64_t pc, uint64_t next_pc,
+                      uint32_t insn, bool retired)
+{
+  hart_timing &t = harts[hart];
+  uint64_t cycles;
+
+  if (retired) {
+    cycles = retired_cycles(t, pc, next_pc, insn);
+  } else {
+    /* A trap or a fetch fault: next_pc is the trap vector, which says
+       nothing about a branch or jump target, and after a fetch fault insn
+       is left over from the previous instruction. */
+    traps++;
+    trap_cycles += trap_penalty;
+    cycles = trap_penalty;
+  }
+  if (rv_cache_enabled) {
+    uint64_t now = rv_cache_cycles();
+    memory_cycles += now - last_cache_cycles;
+    cycles += now - last_cache_cycles;
+    last_cache_cycles = now;
+  }
+  t.cycles += cycles;
+  total_cycles += cycles;
+}
+
+uint64_t rv_timing_take_cycles(uint64_t hart)
+{
+  hart_timing &t = harts[hart];
+  uint64_t cycles = t.cycles - t.taken;
+  t.taken = t.cycles;
+  return cycles;
+}
+
+uint64_t rv_timing_idle(uint64_t insns)
+{
+  /* The hart would have retired a WFI for each, with no other effect. */
+  uint64_t cycles = insns * class_latency[CLASS_SYSTEM];
+  idle_insns += insns;
+  idle_cycles += cycles;
+  total_cycles += cycles;
+  return cycles;
+}
+
+static void report_line(FILE *f, const char *name, uint64_t count,
+                        uint64_t cycles, uint64_t insns)
+{
+  fprintf(f, "%-12s %14" PRIu64 " %16" PRIu64 " %8.3f %7.2f%%\n", name, count,
+          cycles, insns ? (double)cycles / insns : 0.0,
+          total_cycles ? 100.0 * cycles / total_cycles : 0.0);
+}
+
+static double percent(uint64_t part, uint64_t whole)
+{
+  return whole ? 100.0 * part / whole : 0.0;
+}
+
+void rv_timing_write_report(const char *path)
+{
+  FILE *f = stderr;
+  if (path != NULL) {
+    f = fopen(path, "w");
+    if (f == NULL) {
+      fprintf(stderr, "Cannot open timing report '%s': %s\n", path,
+              strerror(errno));
+      return;
+    }
+  }
+  uint64_t insns = 0;
+  for (unsigned i = 0; i < NUM_CLASSES; i++)
+    insns += class_insns[i];
+  fprintf(f, "# %s predictor, %u bits, %u RAS entries, %u BTB bits\n",
+          predictor_names[predictor], bp_bits, ras_entries, btb_bits);
+  fprintf(f,
+          "# %" PRIu64 " instructions, %" PRIu64 " cycles, CPI %.3f\n", insns,
+          total_cycles, insns ? (double)total_cycles / insns : 0.0);
+  fprintf(f,
+          "# branches %" PRIu64 ", mispredicted %" PRIu64 " (%.2f%%); "
+          "returns %" PRIu64 ", mispredicted %" PRIu64 " (%.2f%%); "
+          "indirect jumps %" PRIu64 ", mispredicted %" PRIu64 " (%.2f%%)\n",
+          branches, branch_misses, percent(branch_misses, branches), returns,
+          return_misses, percent(return_misses, returns), indirect_jumps,
+          indirect_misses, percent(indirect_misses, indirect_jumps));
+  fprintf(f, "%-12s %14s %16s %8s %8s\n", "component", "count", "cycles",
+          "CPI", "share");
+  for (unsigned i = 0; i < NUM_CLASSES; i++)
+    report_line(f, class_names[i], class_insns[i], class_cycles[i], insns);
+  report_line(f, "mispredict", branch_misses + return_misses + indirect_misses,
+              mispredict_cycles, insns);
+  report_line(f, "trap", traps, trap_cycles, insns);
+  if (idle_insns != 0)
+    report_line(f, "idle", idle_insns, idle_cycles, insns);
+  if (rv_cache_enabled)
+    report_line(f, "memory", insns, memory_cycles, insns);
+  if (f != stderr)
+    fclose(f);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Timing model for first-order performance estimates.
+
+   When enabled, every retired instruction is charged an estimated number of
+   cycles, which then drives mcycle in place of one cycle per instruction:
+
+   - a latency for its class (alu, mul, div, load, store, amo, branch, jump,
+     fp, fdiv, vector, system), as classified from its encoding;
+   - a misprediction penalty for a conditional branch whose direction is
+     mispredicted, and for an indirect jump whose target is. Directions come
+     from a bimodal, gshare or TAGE-like predictor; returns are predicted by a
+     return address stack, other indirect jumps by a table of last targets;
+   - a flush penalty for a trap or an xRET. An instruction that traps is
+     charged this alone, and is not used to train the predictors;
+   - with the cache model, the cycles it estimates for the instruction's
+     memory accesses.
+
+   Each hart has its own predictor state. mtime still advances with the
+   instruction count, so timer interrupts arrive at the same point of
+   execution with or without the model. A WFI that skips ahead to the next
+   timer interrupt is charged as the WFIs the hart would have retired while
+   waiting, and these are reported apart from the instruction counts.
+ */
+
+/* Set when a configuration has been given; checked before every call into
+   the model so that it costs nothing when disabled. */
+extern bool rv_timing_enabled;
+
+/* Parses a configuration: a comma-separated list of
+     predictor=bimodal|gshare|tage, bp-bits=BITS, history=BITS, ras=ENTRIES,
+     btb-bits=BITS, mispredict=CYCLES, trap=CYCLES, CLASS=CYCLES
+   where CLASS is one of the instruction classes above. Returns false after
+   printing an error if the list is invalid. */
+bool rv_timing_configure(const char *config);
+
+/* Builds the predictors of `harts` harts of width `xlen`. */
+void rv_timing_init(uint64_t harts, unsigned xlen);
+
+/* Records the execution on `hart` of the instruction `insn` at `pc`, with
+   `next_pc` the PC after it. `retired` is false if it trapped instead. */
+void rv_timing_retire(uint64_t hart, uint64_t pc, uint64_t next_pc,
+                      uint32_t insn, bool retired);
+
+/* Returns the cycles charged to `hart` since the last call. */
+uint64_t rv_timing_take_cycles(uint64_t hart);
+
+/* Charges the `insns` instructions a WFI skipped over as idle time, and
+   returns their cycles. These are not added to rv_timing_take_cycles. */
+uint64_t rv_timing_idle(uint64_t insns);
+
+/* Writes the CPI breakdown and predictor statistics to `path`, or to stderr
+   if it is NULL. */
+void rv_timing_write_report(const char *path);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
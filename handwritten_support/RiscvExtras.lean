@@ -64,6 +64,13 @@ variable {Register : Type} {RegisterType : Register → Type} [DecidableEq Regis
 axiom plat_term_write {α} : α → SailM Unit
 axiom plat_term_read : Unit → SailM String
 
+-- Timing
+axiom plat_wfi_cycles : Int → SailM Int
+
+-- Cache model
+axiom plat_cache_block_op : BitVec 2 → BitVec 64 → SailM Unit
+axiom plat_cache_access : BitVec 2 → BitVec 64 → BitVec 64 → SailM (BitVec 2)
+
 -- Reservations
 axiom load_reservation : Arch.pa → SailM Unit
 axiom match_reservation : Arch.pa → Bool
@@ -0,0 +1,90 @@
+// Floating-point benchmark kernel: dense matrix multiplication and a small
+// n-body integration in double precision. Used by tools/bench.py; it also
+// runs as a test, so the result is checked.
+
+#include "common/runtime.h"
+
+#ifndef ITERATIONS
+#define ITERATIONS 20
+#endif
+
+#define N 16
+#define BODIES 5
+
+static double a[N][N], b[N][N], c[N][N];
+
+typedef struct {
+  double x, y, z, vx, vy, vz, mass;
+} body_t;
+
+static double sqrt_newton(double x)
+{
+  double r = x > 1.0 ? x : 1.0;
+  for (int i = 0; i < 20; i++)
+    r = 0.5 * (r + x / r);
+  return r;
+}
+
+static void advance(body_t *bodies, double dt)
+{
+  for (int i = 0; i < BODIES; i++) {
+    for (int j = i + 1; j < BODIES; j++) {
+      double dx = bodies[i].x - bodies[j].x;
+      double dy = bodies[i].y - bodies[j].y;
+      double dz = bodies[i].z - bodies[j].z;
+      double d2 = dx * dx + dy * dy + dz * dz + 0.01;
+      double mag = dt / (d2 * sqrt_newton(d2));
+      bodies[i].vx -= dx * bodies[j].mass * mag;
+      bodies[i].vy -= dy * bodies[j].mass * mag;
+      bodies[i].vz -= dz * bodies[j].mass * mag;
+      bodies[j].vx += dx * bodies[i].mass * mag;
+      bodies[j].vy += dy * bodies[i].mass * mag;
+      bodies[j].vz += dz * bodies[i].mass * mag;
+    }
+  }
+  for (int i = 0; i < BODIES; i++) {
+    bodies[i].x += dt * bodies[i].vx;
+    bodies[i].y += dt * bodies[i].vy;
+    bodies[i].z += dt * bodies[i].vz;
+  }
+}
+
+int main()
+{
+  body_t bodies[BODIES];
+  double trace = 0.0;
+
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      a[i][j] = (double)(i + j) / N;
+      b[i][j] = (i == j) ? 1.0 : 0.0;
+    }
+  }
+  for (int i = 0; i < BODIES; i++)
+    bodies[i] = (body_t){i, 2.0 * i, -1.0 * i, 0, 0, 0, 1.0 + i};
+
+  for (int iter = 0; iter < ITERATIONS; iter++) {
+    for (int i = 0; i < N; i++) {
+      for (int j = 0; j < N; j++) {
+        double s = 0.0;
+        for (int k = 0; k < N; k++)
+          s += a[i][k] * b[k][j];
+        c[i][j] = s;
+      }
+    }
+    // b is the identity, so c must equal a.
+    for (int i = 0; i < N; i++) {
+      if (c[i][i] != a[i][i]) {
+        printf("matrix multiply failed\n");
+        return 1;
+      }
+      trace += c[i][i];
+    }
+    for (int step = 0; step < 10; step++)
+      advance(bodies, 0.01);
+  }
+
+  printf("bench_fp: %d iterations, trace %d, x0 %d\n", ITERATIONS, (int)trace,
+         (int)(bodies[0].x * 1000));
+  return 0;
+}
@@ -0,0 +1,120 @@
+// Integer benchmark kernel in the style of Dhrystone: string handling,
+// record copies, branches, multiplication/division and a table-driven CRC.
+// Used by tools/bench.py; it also runs as a test, so the result is checked.
+
+#include "common/runtime.h"
+
+#ifndef ITERATIONS
+#define ITERATIONS 2000
+#endif
+
+// The checksum after the default number of iterations. The pseudo-random
+// values wrap at XLEN bits, so it differs between RV32 and RV64.
+#if !defined(EXPECTED_CHECKSUM) && ITERATIONS == 2000
+#if __riscv_xlen == 32
+#define EXPECTED_CHECKSUM 0x0d2567d1u
+#else
+#define EXPECTED_CHECKSUM 0x3769bb6cu
+#endif
+#endif
+
+typedef struct {
+  int_xlen_t id;
+  int_xlen_t value;
+  char name[32];
+} record_t;
+
+static uint32_t crc_table[256];
+
+static void crc_init(void)
+{
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++)
+      c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+    crc_table[i] = c;
+  }
+}
+
+static uint32_t crc32(uint32_t crc, const char *p, int len)
+{
+  crc = ~crc;
+  for (int i = 0; i < len; i++)
+    crc = crc_table[(crc ^ (uint8_t)p[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+static int str_copy(char *dst, const char *src)
+{
+  int n = 0;
+  while ((dst[n] = src[n]) != '\0')
+    n++;
+  return n;
+}
+
+static int str_compare(const char *a, const char *b)
+{
+  while (*a != '\0' && *a == *b) {
+    a++;
+    b++;
+  }
+  return (unsigned char)*a - (unsigned char)*b;
+}
+
+static void insertion_sort(int_xlen_t *v, int n)
+{
+  for (int i = 1; i < n; i++) {
+    int_xlen_t x = v[i];
+    int j = i - 1;
+    while (j >= 0 && v[j] > x) {
+      v[j + 1] = v[j];
+      j--;
+    }
+    v[j + 1] = x;
+  }
+}
+
+int main()
+{
+  static record_t records[8];
+  static int_xlen_t values[32];
+  const char *names[] = {"DHRYSTONE PROGRAM, 1'ST STRING",
+                         "DHRYSTONE PROGRAM, 2'ND STRING"};
+  uint32_t crc = 0;
+  uint_xlen_t seed = 12345;
+
+  crc_init();
+  for (int iter = 0; iter < ITERATIONS; iter++) {
+    record_t *r = &records[iter % 8];
+    r->id = iter;
+    int len = str_copy(r->name, names[iter & 1]);
+    if (str_compare(r->name, names[0]) == 0)
+      r->value = iter * 3 + len;
+    else
+      r->value = (iter * 7) / 3 - len;
+    records[(iter + 1) % 8] = *r;
+
+    for (int i = 0; i < 32; i++) {
+      seed = seed * 1103515245u + 12345u;
+      values[i] = (int_xlen_t)((seed >> 16) % 1000);
+    }
+    insertion_sort(values, 32);
+    for (int i = 1; i < 32; i++) {
+      if (values[i - 1] > values[i]) {
+        printf("sort failed\n");
+        return 1;
+      }
+    }
+    crc = crc32(crc, r->name, len);
+    crc ^= (uint32_t)(r->value + values[iter % 32]);
+  }
+
+  printf("bench_int: %d iterations, checksum %x\n", ITERATIONS, crc);
+#ifdef EXPECTED_CHECKSUM
+  if (crc != EXPECTED_CHECKSUM) {
+    printf("expected checksum %x\n", EXPECTED_CHECKSUM);
+    return 1;
+  }
+#endif
+  return 0;
+}
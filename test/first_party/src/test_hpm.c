@@ -0,0 +1,129 @@
+// Self-checking test of the Zihpm event counters (model/riscv_hpm_events.sail)
+// with the Sscofpmf filters and overflow.
+//
+// mhpmcounter3 counts taken branches and jumps (model event 3) over a fixed
+// run of jumps. It must count every one, nothing when mcountinhibit or the
+// machine-mode filter (MINH) stops it, and every one again when only the
+// other modes are filtered. A counter that wraps must set the OF bit of
+// mhpmevent3 and raise a local counter overflow interrupt.
+
+#include "common/encoding.h"
+#include "common/runtime.h"
+
+#define HPM_EVENT_TAKEN_BRANCH 3
+#define JUMPS 4
+
+// Sscofpmf bits of mhpmevent, in its upper half.
+#define HPMEVENT_OF (UINT64_C(1) << 63)
+#define HPMEVENT_MINH (UINT64_C(1) << 62)
+#define HPMEVENT_SINH (UINT64_C(1) << 61)
+#define HPMEVENT_UINH (UINT64_C(1) << 60)
+
+#define MCOUNTINHIBIT_HPM3 (1 << 3)
+
+static void write_mhpmevent3(uint64_t value)
+{
+#if __riscv_xlen == 32
+  write_csr(mhpmevent3h, (uint32_t)(value >> 32));
+#endif
+  write_csr(mhpmevent3, (uint_xlen_t)value);
+}
+
+static uint64_t read_mhpmevent3(void)
+{
+#if __riscv_xlen == 32
+  return (uint64_t)read_csr(mhpmevent3h) << 32 | read_csr(mhpmevent3);
+#else
+  return read_csr(mhpmevent3);
+#endif
+}
+
+static void write_mhpmcounter3(uint64_t value)
+{
+#if __riscv_xlen == 32
+  write_csr(mhpmcounter3h, (uint32_t)(value >> 32));
+#endif
+  write_csr(mhpmcounter3, (uint_xlen_t)value);
+}
+
+static uint64_t read_mhpmcounter3(void)
+{
+#if __riscv_xlen == 32
+  return (uint64_t)read_csr(mhpmcounter3h) << 32 | read_csr(mhpmcounter3);
+#else
+  return read_csr(mhpmcounter3);
+#endif
+}
+
+// Returns how far the low half of mhpmcounter3 moves over JUMPS taken jumps.
+// Everything is in one asm statement so that no compiled branch is counted.
+static uint_xlen_t count_jumps(void)
+{
+  uint_xlen_t before, after;
+  asm volatile("csrr %0, mhpmcounter3\n"
+               "j 1f\n"
+               "1: j 1f\n"
+               "1: j 1f\n"
+               "1: j 1f\n"
+               "1: csrr %1, mhpmcounter3\n"
+               : "=&r"(before), "=r"(after));
+  return after - before;
+}
+
+static int check_count(const char *what, uint64_t event, uint_xlen_t expected)
+{
+  write_mhpmevent3(event);
+  uint_xlen_t count = count_jumps();
+  if (count != expected) {
+    printf("%s: counted %u jumps (expected %u)\n", what, (unsigned)count,
+           (unsigned)expected);
+    return 1;
+  }
+  return 0;
+}
+
+int main()
+{
+  if (check_count("counting", HPM_EVENT_TAKEN_BRANCH, JUMPS))
+    return 1;
+
+  set_csr(mcountinhibit, MCOUNTINHIBIT_HPM3);
+  if (check_count("mcountinhibit", HPM_EVENT_TAKEN_BRANCH, 0))
+    return 1;
+  clear_csr(mcountinhibit, MCOUNTINHIBIT_HPM3);
+
+  // This test runs in machine mode.
+  if (check_count("MINH", HPMEVENT_MINH | HPM_EVENT_TAKEN_BRANCH, 0)
+      || check_count("SINH and UINH",
+                     HPMEVENT_SINH | HPMEVENT_UINH | HPM_EVENT_TAKEN_BRANCH,
+                     JUMPS))
+    return 1;
+
+  // Overflow: the counter wraps on the second jump.
+  write_mhpmevent3(HPM_EVENT_TAKEN_BRANCH);
+  write_mhpmcounter3(~UINT64_C(1));
+  count_jumps();
+  uint64_t counter = read_mhpmcounter3();
+  uint64_t event = read_mhpmevent3();
+  if (counter != JUMPS - 2 || !(event & HPMEVENT_OF)) {
+    printf("overflow: counter %u, OF %u (expected %u, 1)\n",
+           (unsigned)counter, (unsigned)!!(event & HPMEVENT_OF),
+           JUMPS - 2);
+    return 1;
+  }
+  if (!(read_csr(mip) & MIP_LCOFIP)) {
+    printf("overflow did not raise a local counter overflow interrupt\n");
+    return 1;
+  }
+
+  // With OF already set, a second wrap raises no new interrupt.
+  clear_csr(mip, MIP_LCOFIP);
+  write_mhpmcounter3(~UINT64_C(1));
+  count_jumps();
+  if (read_csr(mip) & MIP_LCOFIP) {
+    printf("overflow with OF set raised an interrupt\n");
+    return 1;
+  }
+
+  return 0;
+}
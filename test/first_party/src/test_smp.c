@@ -0,0 +1,78 @@
+// Self-checking test of multiple harts. Needs --harts 2.
+//
+// Both harts count up a shared counter with LR/SC, interleaved by a short
+// scheduling quantum so that harts switch between the LR and the SC. Hart 0
+// wakes hart 1 with a software interrupt through the CLINT, and hart 1 wakes
+// hart 0 the same way once it has finished counting.
+
+#include "common/encoding.h"
+#include "common/runtime.h"
+
+#define CLINT_MSIP(hart) ((volatile uint32_t *)(uintptr_t)(0x2000000 + 4 * (hart)))
+
+#define INCREMENTS 1000
+
+static volatile uint32_t counter;
+static volatile uint32_t hart1_woken;
+
+static void atomic_increment(volatile uint32_t *p)
+{
+  uint32_t value, failed;
+  do {
+    asm volatile("lr.w %0, (%2)\n"
+                 "addi %0, %0, 1\n"
+                 "sc.w %1, %0, (%2)\n"
+                 : "=&r"(value), "=&r"(failed)
+                 : "r"(p)
+                 : "memory");
+  } while (failed);
+}
+
+static void count(void)
+{
+  for (int i = 0; i < INCREMENTS; i++)
+    atomic_increment(&counter);
+}
+
+// Waits for a software interrupt with interrupts disabled, then
+// acknowledges it.
+static void wait_for_ipi(unsigned hart)
+{
+  while (!(read_csr(mip) & MIP_MSIP))
+    asm volatile("wfi");
+  *CLINT_MSIP(hart) = 0;
+}
+
+__attribute__((noreturn)) static void hart1(void)
+{
+  set_csr(mie, MIP_MSIP);
+  wait_for_ipi(1);
+  hart1_woken = 1;
+  count();
+  *CLINT_MSIP(0) = 1;
+  // Only hart 0 reports the result.
+  for (;;)
+    asm volatile("wfi");
+}
+
+int main()
+{
+  if (read_csr(mhartid) != 0)
+    hart1();
+
+  set_csr(mie, MIP_MSIP);
+  *CLINT_MSIP(1) = 1;
+  count();
+  wait_for_ipi(0);
+
+  if (!hart1_woken) {
+    printf("hart 1 signalled without being woken\n");
+    return 1;
+  }
+  if (counter != 2 * INCREMENTS) {
+    printf("counter is %u (expected %u)\n", (unsigned)counter,
+           2 * INCREMENTS);
+    return 1;
+  }
+  return 0;
+}
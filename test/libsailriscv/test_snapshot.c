@@ -0,0 +1,144 @@
+// Runs a first-party test program through libsailriscv, takes a snapshot
+// part of the way through, and checks that running on from the restored
+// snapshot ends exactly as the first run did.
+//
+// Usage: test_snapshot <elf>
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "libsailriscv.h"
+
+// The first-party programs are linked at the start of RAM (see
+// test/first_party/src/common/link.ld) and are much smaller than this.
+#define PROGRAM_BASE UINT64_C(0x80000000)
+#define PROGRAM_LEN UINT64_C(0x100000)
+
+#define CSR_MINSTRET 0xb02
+
+// Steps before the snapshot; enough to be inside main().
+#define SNAPSHOT_STEPS 500
+
+// Bound on the steps of a run, so a broken model fails rather than hangs.
+#define MAX_STEPS 10000000
+
+struct outcome {
+  uint64_t retired;
+  uint64_t exit_code;
+  uint64_t pc;
+  uint64_t minstret;
+  uint64_t gprs[32];
+};
+
+static int run_to_halt(sailriscv_t *h, struct outcome *out)
+{
+  uint64_t retired;
+  sailriscv_status_t status = sailriscv_step(h, MAX_STEPS, &retired);
+  if (status != SAILRISCV_HALTED) {
+    fprintf(stderr, "run ended with status %d after %" PRIu64 " steps\n",
+            (int)status, retired);
+    return 1;
+  }
+  out->retired = retired;
+  out->exit_code = sailriscv_exit_code(h);
+  out->pc = sailriscv_get_pc(h);
+  if (sailriscv_get_csr(h, CSR_MINSTRET, &out->minstret) != SAILRISCV_OK) {
+    fprintf(stderr, "cannot read minstret\n");
+    return 1;
+  }
+  for (unsigned r = 0; r < 32; r++)
+    sailriscv_get_gpr(h, r, &out->gprs[r]);
+  return 0;
+}
+
+static int compare(const struct outcome *a, const struct outcome *b)
+{
+  int failed = 0;
+  if (a->retired != b->retired) {
+    fprintf(stderr, "retired %" PRIu64 " vs %" PRIu64 "\n", a->retired,
+            b->retired);
+    failed = 1;
+  }
+  if (a->exit_code != b->exit_code) {
+    fprintf(stderr, "exit code %" PRIu64 " vs %" PRIu64 "\n", a->exit_code,
+            b->exit_code);
+    failed = 1;
+  }
+  if (a->pc != b->pc) {
+    fprintf(stderr, "pc 0x%" PRIx64 " vs 0x%" PRIx64 "\n", a->pc, b->pc);
+    failed = 1;
+  }
+  if (a->minstret != b->minstret) {
+    fprintf(stderr, "minstret %" PRIu64 " vs %" PRIu64 "\n", a->minstret,
+            b->minstret);
+    failed = 1;
+  }
+  for (unsigned r = 0; r < 32; r++) {
+    if (a->gprs[r] != b->gprs[r]) {
+      fprintf(stderr, "x%u 0x%" PRIx64 " vs 0x%" PRIx64 "\n", r, a->gprs[r],
+              b->gprs[r]);
+      failed = 1;
+    }
+  }
+  return failed;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <elf>\n", argv[0]);
+    return 2;
+  }
+  if (sailriscv_api_version() != SAILRISCV_API_VERSION) {
+    fprintf(stderr, "library API version %u, header version %u\n",
+            sailriscv_api_version(), SAILRISCV_API_VERSION);
+    return 1;
+  }
+
+  sailriscv_t *h = sailriscv_create();
+  if (h == NULL) {
+    fprintf(stderr, "cannot create the model\n");
+    return 1;
+  }
+
+  int failed = 1;
+  sailriscv_snapshot_t *snap = NULL;
+  uint64_t entry;
+  if (sailriscv_load_elf(h, argv[1], &entry) != SAILRISCV_OK) {
+    fprintf(stderr, "cannot load %s\n", argv[1]);
+    goto out;
+  }
+  sailriscv_reset(h, entry, NULL, 0);
+
+  if (sailriscv_step(h, SNAPSHOT_STEPS, NULL) != SAILRISCV_OK) {
+    fprintf(stderr, "program ended before the snapshot\n");
+    goto out;
+  }
+  sailriscv_range_t range = {PROGRAM_BASE, PROGRAM_LEN};
+  snap = sailriscv_snapshot(h, &range, 1);
+  if (snap == NULL) {
+    fprintf(stderr, "cannot take a snapshot\n");
+    goto out;
+  }
+
+  struct outcome first, second;
+  if (run_to_halt(h, &first))
+    goto out;
+  if (first.exit_code != 0) {
+    fprintf(stderr, "program exited with %" PRIu64 "\n", first.exit_code);
+    goto out;
+  }
+
+  if (sailriscv_restore(h, snap) != SAILRISCV_OK) {
+    fprintf(stderr, "cannot restore the snapshot\n");
+    goto out;
+  }
+  if (run_to_halt(h, &second))
+    goto out;
+  failed = compare(&first, &second);
+
+out:
+  sailriscv_snapshot_free(snap);
+  sailriscv_destroy(h);
+  return failed;
+}
@@ -0,0 +1,100 @@
+// Checks the basic-block vectors written by c_emulator/riscv_bbv.cpp for
+// synthetic instruction streams.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "riscv_bbv.h"
+
+// Encodings only matter for their length.
+static const uint32_t INSN32 = 0x00000013; // nop
+static const uint32_t INSN16 = 0x0001;     // c.nop
+
+static std::string bbv_path;
+static int failures = 0;
+
+static std::string read_file(const std::string &path)
+{
+  std::string text;
+  FILE *f = fopen(path.c_str(), "r");
+  if (f == NULL)
+    return text;
+  int c;
+  while ((c = fgetc(f)) != EOF)
+    text += (char)c;
+  fclose(f);
+  return text;
+}
+
+static void open_bbv(uint64_t interval)
+{
+  if (!rv_bbv_open(bbv_path.c_str(), interval, NULL))
+    exit(1);
+}
+
+static void expect(const char *name, const std::string &expected)
+{
+  rv_bbv_close();
+  std::string actual = read_file(bbv_path);
+  if (actual != expected) {
+    fprintf(stderr, "%s: expected\n%sgot\n%s", name, expected.c_str(),
+            actual.c_str());
+    failures++;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <scratch file>\n", argv[0]);
+    return 2;
+  }
+  bbv_path = argv[1];
+
+  // A loop of mixed-length instructions is one block.
+  open_bbv(100);
+  for (int i = 0; i < 2; i++) {
+    rv_bbv_retire(0x100, 0x104, INSN32);
+    rv_bbv_retire(0x104, 0x106, INSN16);
+    rv_bbv_retire(0x106, 0x100, INSN32);
+  }
+  expect("loop", "T:1:6 \n");
+
+  // A compressed jump over a compressed instruction ends its block even
+  // though the PC moves by 4, and a 4-byte instruction that moves the PC by
+  // 2 is a jump too.
+  open_bbv(100);
+  for (int i = 0; i < 2; i++) {
+    rv_bbv_retire(0x200, 0x204, INSN16);
+    rv_bbv_retire(0x204, 0x208, INSN32);
+    rv_bbv_retire(0x208, 0x20a, INSN32);
+    rv_bbv_retire(0x20a, 0x200, INSN16);
+  }
+  expect("compressed jump", "T:1:2 :2:4 :3:2 \n");
+
+  // A not-taken branch does not end a block; a trap between instructions
+  // does.
+  open_bbv(100);
+  rv_bbv_retire(0x300, 0x304, INSN32);
+  rv_bbv_retire(0x304, 0x308, INSN32);
+  rv_bbv_retire(0x900, 0x904, INSN32);
+  rv_bbv_retire(0x904, 0x300, INSN32);
+  rv_bbv_retire(0x300, 0x304, INSN32);
+  expect("trap", "T:1:3 :2:2 \n");
+
+  // A block that spans an interval boundary is counted in both intervals
+  // under its own id, and blocks keep their ids across intervals.
+  open_bbv(4);
+  for (int i = 0; i < 3; i++) {
+    rv_bbv_retire(0x400, 0x404, INSN32);
+    rv_bbv_retire(0x404, 0x408, INSN32);
+    rv_bbv_retire(0x408, 0x400, INSN32);
+  }
+  rv_bbv_retire(0x500, 0x504, INSN32);
+  expect("intervals", "T:1:4 \nT:1:4 \nT:1:1 :2:1 \n");
+
+  remove(bbv_path.c_str());
+  return failures != 0;
+}
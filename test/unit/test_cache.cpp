@@ -0,0 +1,125 @@
+// Checks the hits, misses and replacement order of the cache model in
+// c_emulator/riscv_cache.cpp for synthetic access streams.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "riscv_cache.h"
+
+// 64 byte lines, so line n is at address n * 64.
+static const unsigned LINE_EXP = 6;
+
+static std::string report_path;
+static int failures = 0;
+
+static void init(const char *config)
+{
+  if (!rv_cache_configure(config) || !rv_cache_init(LINE_EXP, 1))
+    exit(1);
+}
+
+// Runs one access per character of `ops`, 'l' for a load and 's' for a
+// store, of the lines in `lines`, and checks that they hit ('h') or missed
+// ('m') as in `expected`.
+static void expect_misses(const char *name, const char *ops,
+                          const unsigned *lines, const char *expected)
+{
+  std::string actual;
+  for (size_t i = 0; ops[i] != '\0'; i++) {
+    unsigned kind = ops[i] == 's' ? RV_CACHE_STORE : RV_CACHE_LOAD;
+    unsigned misses =
+        rv_cache_access(0, kind, (uint64_t)lines[i] << LINE_EXP, 8);
+    actual += misses == 0 ? 'h' : 'm';
+  }
+  if (actual != expected) {
+    fprintf(stderr, "%s: expected %s, got %s\n", name, expected,
+            actual.c_str());
+    failures++;
+  }
+}
+
+struct stats {
+  uint64_t accesses, misses, read_misses, write_misses, writebacks;
+};
+
+// Reads the statistics of cache `name` back from the report.
+static bool read_stats(const char *name, stats *s)
+{
+  rv_cache_write_report(report_path.c_str());
+  FILE *f = fopen(report_path.c_str(), "r");
+  if (f == NULL)
+    return false;
+  char line[256], cache[16];
+  uint64_t size;
+  unsigned ways;
+  double miss_rate;
+  bool found = false;
+  while (!found && fgets(line, sizeof(line), f) != NULL) {
+    found = sscanf(line,
+                   "%15s %" SCNu64 " %u %" SCNu64 " %" SCNu64 " %lf%% %" SCNu64
+                   " %" SCNu64 " %" SCNu64,
+                   cache, &size, &ways, &s->accesses, &s->misses, &miss_rate,
+                   &s->read_misses, &s->write_misses, &s->writebacks)
+                == 9
+            && strcmp(cache, name) == 0;
+  }
+  fclose(f);
+  return found;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <scratch file>\n", argv[0]);
+    return 2;
+  }
+  report_path = argv[1];
+
+  // LRU, two sets of two ways: lines 0, 2 and 4 share set 0. Line 4 evicts
+  // line 2, the least recently used; line 2 then evicts the dirty line 0,
+  // which is written back, and line 0 evicts line 2 again.
+  init("l1d=256:2,mem=100");
+  static const unsigned lru_lines[] = {0, 2, 0, 4, 2, 4, 0};
+  expect_misses("lru", "sllllll", lru_lines, "mmhmmhm");
+  stats s;
+  if (!read_stats("L1D", &s)) {
+    fprintf(stderr, "lru: no L1D statistics in the report\n");
+    failures++;
+  } else if (s.accesses != 7 || s.misses != 5 || s.read_misses != 4
+             || s.write_misses != 1 || s.writebacks != 1) {
+    fprintf(stderr,
+            "lru: expected 7 accesses, 5 misses (4 read, 1 write), 1 "
+            "writeback; got %" PRIu64 ", %" PRIu64 " (%" PRIu64 ", %" PRIu64
+            "), %" PRIu64 "\n",
+            s.accesses, s.misses, s.read_misses, s.write_misses,
+            s.writebacks);
+    failures++;
+  }
+  // Every access pays the L1 latency of 4, and every miss the memory's.
+  if (rv_cache_cycles() != 7 * 4 + 5 * 100) {
+    fprintf(stderr, "lru: expected %d cycles, got %" PRIu64 "\n",
+            7 * 4 + 5 * 100, rv_cache_cycles());
+    failures++;
+  }
+
+  // Tree pseudo-LRU, one set of four ways. After lines 0-3 fill ways 0-3,
+  // the victims are way 0 (line 0, for line 4), way 2 (line 2, for line 5),
+  // way 0 again (line 4, for line 6) and way 2 (line 5, for line 4, where LRU
+  // would pick line 1). Lines 1, 3, 6 and 4 are then all present.
+  init("l1d=256:4,policy=plru");
+  static const unsigned plru_lines[] = {0, 1, 2, 3, 4, 1, 5,
+                                        3, 6, 4, 1, 3, 6, 4};
+  expect_misses("plru", "llllllllllllll", plru_lines, "mmmmmhmhmmhhhh");
+
+  // Rebuilding the caches empties them.
+  init("l1d=256:4,policy=plru");
+  static const unsigned reinit_lines[] = {1};
+  expect_misses("reinit", "l", reinit_lines, "m");
+
+  remove(report_path.c_str());
+  return failures != 0;
+}
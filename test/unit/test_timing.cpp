@@ -0,0 +1,132 @@
+// Checks the cycles the timing model in c_emulator/riscv_timing.cpp charges
+// for synthetic instructions: class latencies, branch and jump prediction,
+// traps, and the idle time of a WFI that skips ahead.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "riscv_timing.h"
+
+// Encodings, all with x0 as the destination unless noted.
+static const uint32_t ADD = 0x00000033;
+static const uint32_t MUL = 0x02000033;
+static const uint32_t DIV = 0x02004033;
+static const uint32_t LW = 0x00002003;
+static const uint32_t SW = 0x00002023;
+static const uint32_t C_NOP = 0x0001;
+static const uint32_t BEQ = 0x00000063;
+static const uint32_t JAL_RA = 0x000000ef; // jal ra, 0
+static const uint32_t RET = 0x00008067;    // jalr x0, 0(ra)
+static const uint32_t JR_T1 = 0x00030067;  // jalr x0, 0(t1)
+static const uint32_t MRET = 0x30200073;
+
+static std::string report_path;
+static int failures = 0;
+
+static void expect_cycles(const char *name, uint64_t expected)
+{
+  uint64_t actual = rv_timing_take_cycles(0);
+  if (actual != expected) {
+    fprintf(stderr, "%s: expected %" PRIu64 " cycles, got %" PRIu64 "\n",
+            name, expected, actual);
+    failures++;
+  }
+}
+
+// Retires the instruction `insn` at `pc`, continuing at `next_pc`, and checks
+// what it cost.
+static void expect_retire(const char *name, uint64_t pc, uint64_t next_pc,
+                          uint32_t insn, uint64_t expected)
+{
+  rv_timing_retire(0, pc, next_pc, insn, true);
+  expect_cycles(name, expected);
+}
+
+// Reads the instruction and cycle totals back from the report.
+static bool read_totals(uint64_t *insns, uint64_t *cycles)
+{
+  rv_timing_write_report(report_path.c_str());
+  FILE *f = fopen(report_path.c_str(), "r");
+  if (f == NULL)
+    return false;
+  char line[256];
+  bool found = false;
+  while (!found && fgets(line, sizeof(line), f) != NULL) {
+    found = sscanf(line, "# %" SCNu64 " instructions, %" SCNu64 " cycles",
+                   insns, cycles)
+         == 2;
+  }
+  fclose(f);
+  return found;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <scratch file>\n", argv[0]);
+    return 2;
+  }
+  report_path = argv[1];
+
+  if (!rv_timing_configure("predictor=bimodal,mul=3,mispredict=8,trap=20"))
+    return 1;
+  rv_timing_init(1, 64);
+
+  // Class latencies, with the defaults but for mul.
+  rv_timing_retire(0, 0x1000, 0x1004, ADD, true);
+  rv_timing_retire(0, 0x1004, 0x1008, MUL, true);
+  rv_timing_retire(0, 0x1008, 0x100c, DIV, true);
+  rv_timing_retire(0, 0x100c, 0x1010, LW, true);
+  rv_timing_retire(0, 0x1010, 0x1014, SW, true);
+  rv_timing_retire(0, 0x1014, 0x1016, C_NOP, true);
+  expect_cycles("latencies", 1 + 3 + 20 + 2 + 1 + 1);
+  expect_cycles("second take", 0);
+
+  // The bimodal counters start weakly not taken.
+  expect_retire("first taken branch", 0x2000, 0x1f00, BEQ, 1 + 8);
+  expect_retire("second taken branch", 0x2000, 0x1f00, BEQ, 1);
+  expect_retire("untaken branch", 0x2000, 0x2004, BEQ, 1 + 8);
+
+  // Returns are predicted by the return address stack.
+  expect_retire("call", 0x3000, 0x4000, JAL_RA, 1);
+  expect_retire("return", 0x4000, 0x3004, RET, 1);
+  expect_retire("return with an empty stack", 0x4000, 0x3004, RET, 1 + 8);
+
+  // Other indirect jumps go to the last target from the same PC.
+  expect_retire("first indirect jump", 0x5000, 0x6000, JR_T1, 1 + 8);
+  expect_retire("same target", 0x5000, 0x6000, JR_T1, 1);
+  expect_retire("new target", 0x5000, 0x7000, JR_T1, 1 + 8);
+
+  // Traps and xRETs flush the pipeline.
+  rv_timing_retire(0, 0x8000, 0x100, LW, false);
+  expect_cycles("trap", 20);
+  expect_retire("mret", 0x100, 0x8000, MRET, 5 + 20);
+
+  // A WFI skipping 10 instructions costs as much as 10 WFIs, and returns the
+  // cycles rather than leaving them to rv_timing_take_cycles.
+  if (rv_timing_idle(10) != 10 * 5) {
+    fprintf(stderr, "idle: expected %d cycles\n", 10 * 5);
+    failures++;
+  }
+  expect_cycles("after idle", 0);
+
+  // 6 + 3 + 3 + 3 + 1 instructions retired; idle time only adds cycles.
+  uint64_t insns, cycles;
+  uint64_t expected_cycles = 28 + 19 + 11 + 19 + 20 + 25 + 10 * 5;
+  if (!read_totals(&insns, &cycles)) {
+    fprintf(stderr, "report: no totals\n");
+    failures++;
+  } else if (insns != 16 || cycles != expected_cycles) {
+    fprintf(stderr,
+            "report: expected 16 instructions, %" PRIu64
+            " cycles; got %" PRIu64 ", %" PRIu64 "\n",
+            expected_cycles, insns, cycles);
+    failures++;
+  }
+
+  remove(report_path.c_str());
+  return failures != 0;
+}
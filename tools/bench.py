@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Run the simulator benchmark suite and report its performance as JSON.
+
+Each workload is run with --bench-json, which reports the guest instruction
+count, the wall time of initialisation and execution, MIPS, and (where the
+kernel allows perf_event_open) the number of host instructions executed per
+guest instruction. The results are written to a single JSON file:
+
+  {"simulator": ..., "results": [{"name": ..., "category": ..., ...}],
+   "summary": {"<category>": {"mips": <geometric mean>}, ...}}
+
+With --baseline, MIPS is compared against an earlier results file and the
+script exits with status 1 if any workload slowed down by more than
+--threshold percent.
+
+The built-in workloads are the benchmark kernels from test/first_party
+(found in --first-party-dir, the CMake build directory for those tests,
+build/test/first_party by default) and a selection of riscv-tests ELFs.
+The riscv-tests only run a few thousand instructions, so on their own they
+mostly measure start-up time. Further workloads, e.g. vector or
+capability-heavy programs built with a suitable toolchain, can be added
+with --workload NAME:CATEGORY:ELF.
+
+Usage: bench.py --sim SIM [--xlen 64] [-o OUT.json] [--baseline OLD.json]
+"""
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# (name, category, ELF relative to test/riscv-tests) with {xlen} substituted.
+RISCV_TESTS = [
+    ("riscv-tests/add", "integer", "rv{xlen}ui-p-add.elf"),
+    ("riscv-tests/mul", "integer", "rv{xlen}um-p-mul.elf"),
+    ("riscv-tests/amoadd", "integer", "rv{xlen}ua-p-amoadd_w.elf"),
+    ("riscv-tests/add-vm", "integer", "rv{xlen}ui-v-add.elf"),
+    ("riscv-tests/fadd", "fp", "rv{xlen}ud-p-fadd.elf"),
+    ("riscv-tests/fdiv", "fp", "rv{xlen}uf-p-fdiv.elf"),
+]
+
+# (name, category, ELF relative to --first-party-dir).
+FIRST_PARTY = [
+    ("first_party/bench_int", "integer", "rv{xlen}d_bench_int.c.elf"),
+    ("first_party/bench_fp", "fp", "rv{xlen}d_bench_fp.c.elf"),
+]
+FIRST_PARTY_NAMES = {name for name, _, _ in FIRST_PARTY}
+
+
+def run_one(sim, elf, sim_args):
+    with tempfile.NamedTemporaryFile(suffix=".json") as out:
+        cmd = [sim, "--bench-json", out.name] + sim_args + [elf]
+        proc = subprocess.run(cmd, stdout=subprocess.DEVNULL,
+                              stderr=subprocess.PIPE, text=True)
+        if proc.returncode != 0:
+            raise RuntimeError(f"{' '.join(cmd)} failed:\n{proc.stderr}")
+        with open(out.name) as f:
+            return json.load(f)
+
+
+def workloads(args):
+    found = []
+    for name, category, path in RISCV_TESTS:
+        found.append((name, category, os.path.join(
+            ROOT, "test", "riscv-tests", path.format(xlen=args.xlen))))
+    for name, category, path in FIRST_PARTY:
+        found.append((name, category, os.path.join(
+            args.first_party_dir, path.format(xlen=args.xlen))))
+    for spec in args.workload:
+        name, category, path = spec.split(":", 2)
+        found.append((name, category, path))
+    return found
+
+
+def geomean(values):
+    values = [v for v in values if v]
+    if not values:
+        return None
+    return math.exp(sum(math.log(v) for v in values) / len(values))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--sim", required=True)
+    parser.add_argument("--xlen", default="64", choices=["32", "64"])
+    parser.add_argument("--first-party-dir", default=os.path.join(
+        ROOT, "build", "test", "first_party"))
+    parser.add_argument("--workload", action="append", default=[],
+                        metavar="NAME:CATEGORY:ELF")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="runs per workload; the fastest is reported")
+    parser.add_argument("--sim-arg", action="append", default=[],
+                        help="extra simulator argument")
+    parser.add_argument("-o", "--output", default="-")
+    parser.add_argument("--baseline")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="allowed MIPS regression, in percent")
+    args = parser.parse_args()
+
+    results = []
+    for name, category, elf in workloads(args):
+        if not os.path.exists(elf):
+            print(f"{name}: {elf} not found, skipping", file=sys.stderr)
+            continue
+        runs = [run_one(args.sim, elf, args.sim_arg)
+                for _ in range(args.repeat)]
+        best = min(runs, key=lambda r: r["exec_seconds"])
+        best.update(name=name, category=category)
+        results.append(best)
+        mips = best["mips"]
+        print(f"{name}: {best['instructions']} instructions, "
+              f"{mips if mips is not None else '-'} MIPS", file=sys.stderr)
+
+    if not any(r["name"] in FIRST_PARTY_NAMES for r in results):
+        print("warning: no benchmark kernels found in "
+              f"{args.first_party_dir}; configure CMake with "
+              "-DFIRST_PARTY_TESTS=TRUE and build them for meaningful MIPS",
+              file=sys.stderr)
+
+    summary = {}
+    for category in sorted({r["category"] for r in results}):
+        summary[category] = {"mips": geomean(
+            r["mips"] for r in results if r["category"] == category)}
+    report = {"simulator": args.sim, "results": results, "summary": summary}
+
+    text = json.dumps(report, indent=2) + "\n"
+    if args.output == "-":
+        sys.stdout.write(text)
+    else:
+        with open(args.output, "w") as f:
+            f.write(text)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            old = {r["name"]: r for r in json.load(f)["results"]}
+        regressed = False
+        for r in results:
+            before = old.get(r["name"], {}).get("mips")
+            if not before or not r["mips"]:
+                continue
+            change = 100.0 * (r["mips"] - before) / before
+            if change < -args.threshold:
+                regressed = True
+                print(f"REGRESSION {r['name']}: {before:.3f} -> "
+                      f"{r['mips']:.3f} MIPS ({change:+.1f}%)",
+                      file=sys.stderr)
+        if regressed:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
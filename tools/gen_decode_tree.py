@@ -0,0 +1,349 @@
+#!/usr/bin/env python3
+"""Generate a decision-tree decoder from the encdec mapping clauses.
+
+The backwards direction of a scattered mapping compiles to a chain that
+tries every clause in source order, so decoding an instruction costs a test
+per clause until one matches. This script reads the model sources, works out
+which bits each encdec/encdec_compressed clause fixes, and emits Sail that
+switches on the major opcode, funct3 and funct7 fields before falling into a
+small mapping containing only the clauses that can still match.
+
+Each leaf keeps the clauses it contains in their original order, and a clause
+is left in every leaf whose fixed bits it does not contradict (including the
+ILLEGAL catch-all, which fixes nothing), so for any instruction the first
+clause that matches in the leaf is the first one that matches in encdec. The
+generated check_* functions compare the two decoders over a range of
+encodings.
+
+Usage: gen_decode_tree.py -o OUT.sail MODEL.sail...
+
+The inputs must be given in the order they are passed to Sail.
+"""
+
+import argparse
+import re
+import sys
+
+# Mappings to build trees for: (name, width, fields to switch on, from the
+# most to the least selective).
+TREES = [
+    ("encdec", 32, [(6, 0), (14, 12), (31, 25)]),
+    ("encdec_compressed", 16, [(1, 0), (15, 13), (12, 12)]),
+]
+
+# Stop splitting once a leaf has at most this many clauses (not counting
+# clauses that fix none of the remaining fields).
+LEAF_SIZE = 4
+
+# Limit on the number of alternative encodings tracked per clause.
+MAX_ALTS = 256
+
+
+def strip_comments(text):
+    """Blank out comments, keeping line structure and string literals."""
+    out = []
+    i, n, depth = 0, len(text), 0
+    while i < n:
+        c = text[i]
+        if depth > 0:
+            if text.startswith("/*", i):
+                depth += 1
+                out.append("  ")
+                i += 2
+            elif text.startswith("*/", i):
+                depth -= 1
+                out.append("  ")
+                i += 2
+            else:
+                out.append("\n" if c == "\n" else " ")
+                i += 1
+        elif text.startswith("/*", i):
+            depth = 1
+            out.append("  ")
+            i += 2
+        elif text.startswith("//", i):
+            j = text.find("\n", i)
+            j = n if j < 0 else j
+            out.append(" " * (j - i))
+            i = j
+        elif c == '"':
+            j = i + 1
+            while j < n and text[j] != '"':
+                j += 2 if text[j] == "\\" else 1
+            out.append(text[i : j + 1])
+            i = j + 1
+        else:
+            out.append(c)
+            i += 1
+    return "".join(out)
+
+
+def split_top(s, sep):
+    """Split `s` on `sep` where it is not nested in brackets."""
+    parts, depth, start, i = [], 0, 0, 0
+    while i < len(s):
+        c = s[i]
+        if c in "([{":
+            depth += 1
+        elif c in ")]}":
+            depth -= 1
+        elif depth == 0 and s.startswith(sep, i):
+            parts.append(s[start:i])
+            i += len(sep)
+            start = i
+            continue
+        i += 1
+    parts.append(s[start:])
+    return parts
+
+
+def find_guard(s):
+    """Index of a top-level `if` guard in a mapping pattern, or -1."""
+    depth = 0
+    for m in re.finditer(r"[()\[\]{}]|\bif\b", s):
+        t = m.group(0)
+        if t in "([{":
+            depth += 1
+        elif t in ")]}":
+            depth -= 1
+        elif depth == 0:
+            return m.start()
+    return -1
+
+
+class Clause:
+    def __init__(self, name, index, text, where):
+        self.index = index
+        self.text = " ".join(text.split())
+        self.where = where
+        sides = split_top(self.text, "<->")
+        if len(sides) != 2:
+            raise SystemExit(f"{where}: cannot parse {name} clause: {self.text}")
+        self.pattern = sides[1]
+        guard = find_guard(self.pattern)
+        if guard >= 0:
+            self.pattern = self.pattern[:guard]
+        # Alternatives (mask, value): every encoding matched by this clause
+        # agrees with one of them on the bits in its mask.
+        self.alts = [(0, 0)]
+
+    def place(self, widths, total):
+        elems = [e.strip() for e in split_top(self.pattern, "@")]
+        sized = [element_width(e, widths) for e in elems]
+        if all(w is not None for w, _ in sized):
+            if sum(w for w, _ in sized) != total:
+                raise SystemExit(f"{self.where}: pattern is not {total} bits wide: {self.pattern}")
+        # Place literals from the least significant end, then from the most
+        # significant end, stopping at the first element of unknown width.
+        lo = 0
+        for w, v in reversed(sized):
+            if w is None:
+                break
+            self.fix(lo, w, v)
+            lo += w
+        hi = total
+        for w, v in sized:
+            if w is None:
+                break
+            self.fix(hi - w, w, v)
+            hi -= w
+
+    def fix(self, lo, width, values):
+        if values is None:
+            return
+        if len(self.alts) * len(values) > MAX_ALTS:
+            # Too many combinations, keep only the bits all values agree on.
+            agree = (1 << width) - 1
+            for v in values:
+                agree &= ~(v ^ values[0])
+            values, width_mask = [values[0] & agree], agree
+        else:
+            width_mask = (1 << width) - 1
+        self.alts = list({(m | (width_mask << lo), a | (v << lo))
+                          for m, a in self.alts for v in values})
+
+    def allows(self, mask, value):
+        return any((a ^ value) & m & mask == 0 for m, a in self.alts)
+
+
+def literal(e):
+    """(width, value) of a bitvector literal, or None."""
+    m = re.fullmatch(r"0b([01_]+)", e)
+    if m:
+        digits = m.group(1).replace("_", "")
+        return len(digits), int(digits, 2)
+    m = re.fullmatch(r"0x([0-9a-fA-F_]+)", e)
+    if m:
+        digits = m.group(1).replace("_", "")
+        return 4 * len(digits), int(digits, 16)
+    return None
+
+
+def element_width(e, widths):
+    """(width, possible values or None) of a pattern element.
+
+    The width is None if it cannot be determined."""
+    lit = literal(e)
+    if lit:
+        return lit[0], [lit[1]]
+    m = re.fullmatch(r"\w+\s*:\s*bits\((\d+)\)", e)
+    if m:
+        return int(m.group(1)), None
+    m = re.fullmatch(r"(\w+)\s*\(.*\)", e, re.S)
+    if m and m.group(1) in widths:
+        return widths[m.group(1)]
+    return None, None
+
+
+def matching_brace(text, i):
+    depth = 0
+    for j in range(i, len(text)):
+        if text[j] == "{":
+            depth += 1
+        elif text[j] == "}":
+            depth -= 1
+            if depth == 0:
+                return j
+    return len(text)
+
+
+def mapping_values(body):
+    """Encodings of a mapping whose clauses all map to literals, or None."""
+    values = []
+    for cl in split_top(body, ","):
+        if not cl.strip():
+            continue
+        sides = split_top(cl, "<->")
+        if len(sides) != 2:
+            return None
+        rhs = sides[1]
+        guard = find_guard(rhs)
+        lit = literal((rhs[:guard] if guard >= 0 else rhs).strip())
+        if lit is None:
+            return None
+        values.append(lit[1])
+    return values or None
+
+
+def read_sources(paths):
+    widths, clauses = {}, {name: [] for name, _, _ in TREES}
+    clause_re = re.compile(r"^mapping\s+clause\s+(\w+)\s*=", re.M)
+    for path in paths:
+        with open(path) as f:
+            text = strip_comments(f.read())
+        for m in re.finditer(r"\bmapping\s+(\w+)\s*:[^=]*?<->\s*bits\((\d+)\)\s*=\s*\{", text):
+            body = text[m.end() : matching_brace(text, m.end() - 1)]
+            widths[m.group(1)] = (int(m.group(2)), mapping_values(body))
+        lines = text.split("\n")
+        for m in clause_re.finditer(text):
+            if m.group(1) not in clauses:
+                continue
+            # A clause runs on over indented lines and lines starting with <->.
+            line = text.count("\n", 0, m.start())
+            body = [lines[line][m.end() - m.start() :]]
+            for cont in lines[line + 1 :]:
+                if not cont.strip() or not (cont[0].isspace() or cont.startswith("<->")):
+                    break
+                body.append(cont)
+            where = f"{path}:{line + 1}"
+            lst = clauses[m.group(1)]
+            lst.append(Clause(m.group(1), len(lst), "\n".join(body), where))
+    return widths, clauses
+
+
+def build(clauses, fields):
+    """Decision tree over `fields` for `clauses`."""
+    if not fields or len(clauses) <= LEAF_SIZE:
+        return ("leaf", tuple(c.index for c in clauses))
+    (hi, lo), rest = fields[0], fields[1:]
+    fmask = ((1 << (hi - lo + 1)) - 1) << lo
+    children = [[c for c in clauses if c.allows(fmask, v << lo)]
+                for v in range(1 << (hi - lo + 1))]
+    if all(len(sub) == len(clauses) for sub in children):
+        return build(clauses, rest)
+    return ("switch", hi, lo, [build(sub, rest) for sub in children])
+
+
+class Emitter:
+    def __init__(self, name, width, clauses):
+        self.name = name
+        self.width = width
+        self.clauses = clauses
+        self.leaves = {}
+        self.out = []
+
+    def leaf(self, indices):
+        if indices not in self.leaves:
+            self.leaves[indices] = f"{self.name}_tree_{len(self.leaves)}"
+        return self.leaves[indices]
+
+    def expr(self, node, indent):
+        if node[0] == "leaf":
+            return f"{self.leaf(node[1])}(bv)"
+        _, hi, lo, children = node
+        # The most common subtree becomes the default case.
+        keys = [repr(c) for c in children]
+        default = max(set(keys), key=keys.count)
+        pad = " " * indent
+        lines = [f"match bv[{hi} .. {lo}] {{"]
+        for v, child in enumerate(children):
+            if keys[v] != default:
+                lit = format(v, f"0{hi - lo + 1}b")
+                lines.append(f"{pad}  0b{lit} => {self.expr(child, indent + 2)},")
+        lines.append(f"{pad}  _ => {self.expr(children[keys.index(default)], indent + 2)}")
+        lines.append(f"{pad}}}")
+        return "\n".join(lines)
+
+    def emit(self, tree):
+        body = self.expr(tree, 2)
+        for indices, leaf in self.leaves.items():
+            self.out.append(f"mapping {leaf} : ast <-> bits({self.width}) = {{")
+            self.out.append(",\n".join("  " + self.clauses[i].text for i in indices))
+            self.out.append("}\n")
+        self.out.append(f"val {self.name}_tree : bits({self.width}) -> ast")
+        self.out.append(f"function {self.name}_tree(bv) =\n  {body}\n")
+        self.out.append(f"""/* Compares {self.name}_tree with {self.name} on [first, last) and returns the
+ * number of encodings on which they disagree. */
+val check_{self.name}_tree : (bits(64), bits(64)) -> bits(64)
+function check_{self.name}_tree(first, last) = {{
+  var mismatches : bits(64) = zeros();
+  var i = first;
+  while i <_u last do {{
+    let bv : bits({self.width}) = truncate(i, {self.width});
+    if not({self.name}_tree(bv) == {self.name}(bv)) then {{
+      print_string("{self.name}_tree mismatch on ", BitStr(bv));
+      mismatches = mismatches + 1;
+    }};
+    i = i + 1;
+  }};
+  mismatches
+}}
+""")
+        return "\n".join(self.out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("sources", nargs="+")
+    args = parser.parse_args()
+
+    widths, clauses = read_sources(args.sources)
+    parts = ["/* Generated by tools/gen_decode_tree.py. Do not edit. */\n"]
+    for name, width, fields in TREES:
+        if not clauses[name]:
+            raise SystemExit(f"no {name} clauses found")
+        for c in clauses[name]:
+            c.place(widths, width)
+        tree = build(clauses[name], fields)
+        em = Emitter(name, width, clauses[name])
+        parts.append(em.emit(tree))
+        sizes = [len(k) for k in em.leaves]
+        print(f"{name}: {len(clauses[name])} clauses, {len(em.leaves)} leaves, "
+              f"largest {max(sizes)}", file=sys.stderr)
+    with open(args.output, "w") as f:
+        f.write("\n".join(parts))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""Generate per-hart save and restore functions for the model's registers.
+
+The model describes a single hart whose state lives in Sail registers. To
+simulate several harts, the registers of the running hart stay where they
+are and those of the other harts are parked in per-hart vectors. This script
+reads the model sources, finds every register declaration, and emits
+
+  register hart_saved_R : vector(max_harts, T)
+
+for each hart-private register R : T, together with hart_save(h) and
+hart_restore(h), which copy all of them to and from slot h.
+
+Registers that belong to the platform rather than to a hart (the clock, the
+CLINT, devices, host-side caches) are listed in SHARED and left alone.
+
+The same machinery provides snapshots for the embedding library: every
+register except the scratch and cache registers in NOT_SNAPSHOT, shared or
+not, is copied to and from slot s of snapshot_saved_R by snapshot_save(s)
+and snapshot_restore(s).
+
+Usage: gen_hart_state.py -o OUT.sail MODEL.sail...
+"""
+
+import argparse
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from gen_decode_tree import split_top, strip_comments  # noqa: E402
+
+# Registers that are not part of a hart's state, by name or name prefix
+# (ending in "*").
+SHARED = [
+    "mtime",             # platform clock
+    "current_hart",      # CLINT, indexed by hart
+    "clint_*",
+    "revoker_*",         # capability revocation device
+    "pma_regions",       # physical memory map
+    "csr_defined_table*",  # cache keyed on misa
+    "float_result",      # softfloat scratch, only live within an instruction
+    "float_fflags",
+    "rvfi_*",            # RVFI-DII drives a single hart
+]
+
+# Registers left out of snapshots: scratch state that is dead between
+# instructions, and caches that revalidate themselves.
+NOT_SNAPSHOT = [
+    "float_result",
+    "float_fflags",
+    "rvfi_*",
+    "csr_defined_table*",  # refilled when misa differs from its key
+]
+
+# Number of snapshot slots; SAILRISCV_MAX_SNAPSHOTS in libsailriscv.cpp must
+# match.
+LOG2_MAX_SNAPSHOTS = 3
+
+# Registers only saved when a condition holds, to avoid copying large state
+# that is unused in the current configuration.
+GUARDS = [
+    (re.compile(r"vr\d+$"), "sys_enable_vext()"),
+]
+
+
+def matches(name, pats):
+    for pat in pats:
+        if pat.endswith("*") and name.startswith(pat[:-1]) or name == pat:
+            return True
+    return False
+
+
+def read_registers(paths):
+    regs = []
+    decl = re.compile(r"^register\s+(\w+)\s*:(.*)$", re.M)
+    for path in paths:
+        with open(path) as f:
+            text = strip_comments(f.read())
+        for m in decl.finditer(text):
+            name = m.group(1)
+            # The type runs to the initialiser, if any.
+            typ = split_top(m.group(2), "=")[0].strip()
+            if not typ:
+                raise SystemExit(f"{path}: cannot parse type of register {name}")
+            regs.append((name, typ))
+    return regs
+
+
+def emit(regs):
+    hart_regs = [r for r in regs if not matches(r[0], SHARED)]
+    snapshot_regs = [r for r in regs if not matches(r[0], NOT_SNAPSHOT)]
+
+    out = ["/* Generated by tools/gen_hart_state.py. Do not edit. */\n"]
+    for name, typ in hart_regs:
+        out.append(f"register hart_saved_{name} : vector(max_harts, {typ})")
+    out.append("")
+    out.append(f"type log2_max_snapshots : Int = {LOG2_MAX_SNAPSHOTS}")
+    out.append("type max_snapshots : Int = 2 ^ log2_max_snapshots")
+    for name, typ in snapshot_regs:
+        out.append(f"register snapshot_saved_{name} : vector(max_snapshots, {typ})")
+    out.append("")
+
+    def body(regs, slot, fmt):
+        lines, guarded = [f"  let i = unsigned({slot});"], {}
+        for name, _ in regs:
+            cond = next((c for r, c in GUARDS if r.match(name)), None)
+            stmt = fmt.format(name=name)
+            if cond:
+                guarded.setdefault(cond, []).append(stmt)
+            else:
+                lines.append(f"  {stmt};")
+        for cond, stmts in guarded.items():
+            lines.append(f"  if {cond} then {{")
+            lines.extend(f"    {s};" for s in stmts)
+            lines.append("  };")
+        return "\n".join(lines)
+
+    out.append("/* Copies the running hart's registers to slot h. */")
+    out.append("val hart_save : bits(log2_max_harts) -> unit")
+    out.append("function hart_save(h) = {")
+    out.append(body(hart_regs, "h", "hart_saved_{name}[i] = {name}"))
+    out.append("}\n")
+    out.append("/* Loads the registers of the hart saved in slot h. */")
+    out.append("val hart_restore : bits(log2_max_harts) -> unit")
+    out.append("function hart_restore(h) = {")
+    out.append(body(hart_regs, "h", "{name} = hart_saved_{name}[i]"))
+    out.append("}\n")
+    out.append("/* Copies the state of the model, as seen by the running hart, to")
+    out.append(" * snapshot slot s. */")
+    out.append("val snapshot_save : bits(log2_max_snapshots) -> unit")
+    out.append("function snapshot_save(s) = {")
+    out.append(body(snapshot_regs, "s", "snapshot_saved_{name}[i] = {name}"))
+    out.append("}\n")
+    out.append("/* Loads the state saved in snapshot slot s. */")
+    out.append("val snapshot_restore : bits(log2_max_snapshots) -> unit")
+    out.append("function snapshot_restore(s) = {")
+    out.append(body(snapshot_regs, "s", "{name} = snapshot_saved_{name}[i]"))
+    out.append("}\n")
+    return "\n".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("sources", nargs="+")
+    args = parser.parse_args()
+
+    regs = read_registers(args.sources)
+    if not regs:
+        raise SystemExit("no registers found")
+    print(f"hart state: {len(regs)} registers", file=sys.stderr)
+    with open(args.output, "w") as f:
+        f.write(emit(regs))
+
+
+if __name__ == "__main__":
+    main()